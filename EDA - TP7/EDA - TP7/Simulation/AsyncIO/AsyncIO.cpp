@@ -0,0 +1,93 @@
+#include "AsyncIO.h"
+#include "../QuadTree/Codec/Codec.h"
+#include "../Trace/Trace.h"
+#include <memory>
+
+/*AsyncIO constructor. Starts I/O threads.*/
+AsyncIO::AsyncIO(unsigned int threads) : pending(0), stopping(false) {
+	if (!threads)
+		threads = 1;
+
+	for (unsigned int i = 0; i < threads; i++)
+		workers.emplace_back(&AsyncIO::worker, this);
+}
+
+/*Queues a whole-file read.*/
+std::future<byteVec> AsyncIO::read(const std::string& fileName) {
+	auto task = std::make_shared<std::packaged_task<byteVec(void)>>([fileName]() {
+		TraceSpan span("read", "io", fileName.c_str());
+		byteVec data;
+		Codec::readFile(fileName, data);
+		return data;
+		});
+
+	push([task]() {(*task)(); });
+	return task->get_future();
+}
+
+/*Queues a whole-file write.*/
+std::future<void> AsyncIO::write(const std::string& fileName, byteVec&& data) {
+	auto buffer = std::make_shared<byteVec>(std::move(data));
+	auto task = std::make_shared<std::packaged_task<void(void)>>([fileName, buffer]() {
+		TraceSpan span("write", "io", fileName.c_str());
+		Codec::writeFile(fileName, *buffer);
+		});
+
+	push([task]() {(*task)(); });
+	return task->get_future();
+}
+
+/*Blocks until there are no queued or running requests.*/
+void AsyncIO::wait(void) {
+	std::unique_lock<std::mutex> lock(mtx);
+	idle.wait(lock, [this]() {return !pending; });
+}
+
+/*Adds request to queue and wakes up a worker.*/
+void AsyncIO::push(const std::function<void(void)>& request) {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		requests.push_back(request);
+		pending++;
+	}
+	available.notify_one();
+}
+
+/*I/O thread loop. Serves requests in order until AsyncIO is destroyed.
+Errors are stored in each request's future by packaged_task.*/
+void AsyncIO::worker(void) {
+	std::function<void(void)> request;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			available.wait(lock, [this]() {return stopping || requests.size(); });
+
+			if (requests.empty())
+				return;
+
+			request = requests.front();
+			requests.pop_front();
+		}
+
+		request();
+
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			pending--;
+		}
+		idle.notify_all();
+	}
+}
+
+/*AsyncIO destructor. Serves remaining requests and joins threads.*/
+AsyncIO::~AsyncIO() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	available.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
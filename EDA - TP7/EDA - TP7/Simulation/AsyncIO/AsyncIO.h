@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+
+using byteVec = std::vector<unsigned char>;
+
+/*Asynchronous whole-file I/O. Requests are queued and served by a
+small pool of I/O threads, so reads and writes overlap with compression.*/
+class AsyncIO {
+public:
+	AsyncIO(unsigned int = 2);
+	~AsyncIO();
+
+	/*Queues a read. File data is available through the returned future.*/
+	std::future<byteVec> read(const std::string&);
+
+	/*Queues a write. Data is moved into the request.*/
+	std::future<void> write(const std::string&, byteVec&&);
+
+	/*Blocks until every queued request has been served.*/
+	void wait(void);
+
+private:
+	void worker(void);
+	void push(const std::function<void(void)>&);
+
+	/*Prevents from using copy constructor.*/
+	AsyncIO(const AsyncIO&);
+
+	/*Data members.*/
+	/***********************************************/
+	std::vector<std::thread> workers;
+	std::deque<std::function<void(void)>> requests;
+	std::mutex mtx;
+	std::condition_variable available, idle;
+	unsigned int pending;
+	bool stopping;
+	/***********************************************/
+};
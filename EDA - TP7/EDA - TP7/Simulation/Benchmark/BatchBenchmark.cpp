@@ -0,0 +1,372 @@
+#include "BatchBenchmark.h"
+#include "../QuadTree/QuadTree.h"
+#include "../QuadTree/Estimator/Estimator.h"
+#include "../QuadTree/Metrics/Metrics.h"
+#include "../Trace/Trace.h"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+	const char* compressedFormat = "EDA";
+	const char* imageFormat = "png";
+	const double bytesPerMB = 1024.0 * 1024.0;
+
+	/*Returns the given percentile of sorted values.*/
+	double percentile(const std::vector<double>& sorted, double p) {
+		if (sorted.empty())
+			return 0;
+		return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+	}
+
+	/*A double written to JSON, which has no infinity or NaN. Those are
+	written as null, such as the PSNR of a lossless batch.*/
+	struct JsonNumber {
+		double value;
+	};
+
+	std::ostream& operator<<(std::ostream& out, const JsonNumber& number) {
+		if (std::isfinite(number.value))
+			return out << number.value;
+		return out << "null";
+	}
+
+	/*Returns size of a file, or 0 if it can't be read.*/
+	unsigned long long fileSize(const std::string& path) {
+		boost::system::error_code ec;
+		const unsigned long long size = boost::filesystem::file_size(path, ec);
+		return ec ? 0 : size;
+	}
+}
+
+/*BatchBenchmark constructor. Files are compressed at 'threshold' with 'criterion'.
+Compressed and decompressed files are written to 'outDir', named after the
+whole source name, so images that only differ in extension don't share outputs.*/
+BatchBenchmark::BatchBenchmark(const std::vector<std::string>& files, const std::string& outDir, double threshold, SplitCriterion criterion) :
+	accuracy(), fidelity(), outDir(outDir), threshold(threshold), criterion(criterion) {
+	boost::filesystem::create_directories(outDir);
+
+	for (const auto& file : files) {
+		const std::string base = (boost::filesystem::path(outDir) / boost::filesystem::path(file).filename()).string();
+		compressJobs.push_back({ file, base + '.' + compressedFormat });
+		decompressJobs.push_back({ base + '.' + compressedFormat, base + "-out." + imageFormat });
+	}
+}
+
+/*Runs a compression and a decompression batch at each thread count, and then
+estimates and verifies every file against the outputs of the first compression
+batch. Each pass is reported to 'log' once it's done.*/
+const std::vector<BatchBenchmark::Pass>& BatchBenchmark::run(const std::vector<unsigned int>& threads, std::ostream& log) {
+	passes.clear();
+	accuracy = Accuracy();
+	fidelity = Fidelity();
+
+	for (unsigned int count : threads) {
+		for (bool compress : { true, false }) {
+			passes.push_back(runPass(compress ? "compress" : "decompress", count ? count : 1, compress ? compressJobs : decompressJobs, compress));
+			log << passes.back().name << " with " << passes.back().threads << " threads: "
+				<< passes.back().filesPerSecond << " files/s" << std::endl;
+		}
+	}
+
+	if (passes.size()) {
+		accuracy = runEstimates(passes.front().stats.nodes);
+		log << "estimate: " << accuracy.msPerFile << " ms per file" << std::endl;
+
+		fidelity = runVerification(passes.front().stats);
+		log << "verify: " << fidelity.msPerFile << " ms per file" << std::endl;
+	}
+	return passes;
+}
+
+/*Estimates every file at benchmark's threshold on a single thread, and compares
+estimates with compressed files and with 'nodes', the node count of the whole batch.*/
+const BatchBenchmark::Accuracy BatchBenchmark::runEstimates(unsigned long long nodes) const {
+	Accuracy result = {};
+	QuadTree qt(compressedFormat);
+	qt.setCriterion(criterion);
+	double seconds = 0, predicted = 0;
+	unsigned int lossy = 0;
+
+	for (const auto& job : compressJobs) {
+		const unsigned long long actual = fileSize(job.second);
+		std::vector<unsigned char> data;
+		TraceSpan span("estimate file", "batch", job.first.c_str());
+
+		try {
+			Codec::readFile(job.first, data);
+			const Estimate estimate = qt.estimate(data, Codec::extension(job.first), { threshold }).front();
+			if (!actual)
+				continue;
+
+			const double error = 100 * std::abs(estimate.bytes - actual) / actual;
+			result.bytesError += error;
+			result.maxBytesError = std::max(result.maxBytesError, error);
+			if (std::isfinite(estimate.psnr)) {
+				result.psnr += estimate.psnr;
+				lossy++;
+			}
+			predicted += estimate.nodes;
+			seconds += estimate.seconds;
+			result.files++;
+		}
+		catch (std::exception&) {}
+	}
+
+	if (result.files) {
+		result.msPerFile = 1000 * seconds / result.files;
+		result.bytesError /= result.files;
+	}
+	if (lossy)
+		result.psnr /= lossy;
+	result.nodesError = nodes ? 100 * std::abs(predicted - nodes) / nodes : 0;
+	return result;
+}
+
+/*Decompresses every compressed file on a single thread and compares it with
+its image. 'compressed' are the stats of the batch that wrote the files.*/
+const BatchBenchmark::Fidelity BatchBenchmark::runVerification(const CodecStats& compressed) const {
+	using clock = std::chrono::steady_clock;
+
+	Fidelity result = {};
+	QuadTree qt(compressedFormat);
+	unsigned long long error = 0, samples = 0;
+	double seconds = 0;
+
+	for (const auto& job : compressJobs) {
+		std::vector<unsigned char> original, data;
+		TraceSpan span("verify file", "batch", job.first.c_str());
+
+		try {
+			Codec::readFile(job.first, original);
+			Codec::readFile(job.second, data);
+
+			const clock::time_point start = clock::now();
+			const Quality quality = qt.verify(original, Codec::extension(job.first), data);
+			seconds += std::chrono::duration<double>(clock::now() - start).count();
+
+			error += quality.squaredError;
+			samples += quality.samples;
+			result.ssim += quality.ssim;
+			result.files++;
+		}
+		catch (std::exception&) {}
+	}
+
+	if (result.files) {
+		result.msPerFile = 1000 * seconds / result.files;
+		result.ssim /= result.files;
+	}
+	result.mse = samples ? (double)error / samples : 0;
+	result.psnr = Metrics::psnr(error, samples);
+	result.matchesLeaves = error == compressed.squaredError && samples == compressed.samples;
+	return result;
+}
+
+/*Runs every job on 'threads' threads.*/
+const BatchBenchmark::Pass BatchBenchmark::runPass(const std::string& name, unsigned int threads, const jobVec& jobs, bool compress) const {
+	using clock = std::chrono::steady_clock;
+
+	std::vector<double> latencies(jobs.size(), -1);
+	std::vector<std::thread> workers;
+	std::atomic<unsigned int> next(0);
+	CodecStats stats;
+	std::mutex mtx;
+
+	const clock::time_point start = clock::now();
+	for (unsigned int t = 0; t < threads; t++) {
+		workers.emplace_back([this, &jobs, &latencies, &next, &stats, &mtx, compress]() {
+			QuadTree qt(compressedFormat);
+			CodecStats threadStats;
+			qt.setImageFormat(imageFormat);
+			qt.setCriterion(criterion);
+
+			for (unsigned int i; (i = next++) < jobs.size();) {
+				const clock::time_point begin = clock::now();
+				TraceSpan span(compress ? "compress file" : "decompress file", "batch", jobs[i].first.c_str());
+				try {
+					if (compress)
+						qt.compressAndSave(jobs[i].first, jobs[i].second, threshold);
+					else
+						qt.decompressAndSave(jobs[i].first, jobs[i].second);
+					latencies[i] = std::chrono::duration<double, std::milli>(clock::now() - begin).count();
+					threadStats.add(qt.getStats());
+				}
+				catch (std::exception&) {}
+			}
+
+			std::lock_guard<std::mutex> lock(mtx);
+			stats.add(threadStats);
+			});
+	}
+	for (auto& worker : workers)
+		worker.join();
+
+	Pass pass = {};
+	pass.name = name;
+	pass.threads = threads;
+	pass.seconds = std::chrono::duration<double>(clock::now() - start).count();
+	pass.peakMemory = peakMemory();
+	pass.stats = stats;
+
+	/*Failed files count as neither throughput nor latency.*/
+	std::vector<double> sorted;
+	for (unsigned int i = 0; i < jobs.size(); i++) {
+		if (latencies[i] < 0) {
+			pass.failed++;
+			continue;
+		}
+		sorted.push_back(latencies[i]);
+		pass.files++;
+		pass.bytesIn += fileSize(jobs[i].first);
+		pass.bytesOut += fileSize(jobs[i].second);
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	pass.filesPerSecond = pass.seconds > 0 ? pass.files / pass.seconds : 0;
+	pass.mbPerSecond = pass.seconds > 0 ? pass.bytesIn / bytesPerMB / pass.seconds : 0;
+	pass.p50 = percentile(sorted, 0.5);
+	pass.p90 = percentile(sorted, 0.9);
+	pass.p99 = percentile(sorted, 0.99);
+	pass.maxLatency = sorted.size() ? sorted.back() : 0;
+	return pass;
+}
+
+/*Prints results as a table.*/
+void BatchBenchmark::print(std::ostream& out) const {
+	out << std::left << std::setw(12) << "pass" << std::right << std::setw(8) << "threads" << std::setw(8) << "files"
+		<< std::setw(8) << "failed" << std::setw(10) << "files/s" << std::setw(10) << "MB/s" << std::setw(10) << "p50 ms"
+		<< std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << std::setw(12) << "peak MB" << std::endl;
+
+	for (const auto& pass : passes) {
+		out << std::left << std::setw(12) << pass.name << std::right << std::setw(8) << pass.threads << std::setw(8) << pass.files
+			<< std::setw(8) << pass.failed << std::fixed << std::setprecision(1) << std::setw(10) << pass.filesPerSecond
+			<< std::setw(10) << pass.mbPerSecond << std::setprecision(2) << std::setw(10) << pass.p50 << std::setw(10) << pass.p90
+			<< std::setw(10) << pass.p99 << std::setw(10) << pass.maxLatency << std::setprecision(1)
+			<< std::setw(12) << pass.peakMemory / bytesPerMB << std::endl;
+	}
+
+	/*Codec stats, so the slowest stage of each pass shows.*/
+	out << std::endl;
+	for (const auto& pass : passes) {
+		out << pass.name << " with " << pass.threads << " threads, ";
+		pass.stats.print(out);
+	}
+
+	/*Estimates, against actual results.*/
+	out << std::endl << "estimate of " << accuracy.files << " files: " << std::fixed << std::setprecision(2) << accuracy.msPerFile << " ms per file, bytes off by "
+		<< accuracy.bytesError << "% (max " << accuracy.maxBytesError << "%), nodes off by " << accuracy.nodesError << "%, mean PSNR "
+		<< accuracy.psnr << " dB" << std::endl;
+
+	/*Round trip quality, against the error compression added up.*/
+	out << "verify of " << fidelity.files << " files: " << fidelity.msPerFile << " ms per file, MSE " << std::setprecision(4) << fidelity.mse
+		<< ", PSNR " << std::setprecision(2) << fidelity.psnr << " dB, SSIM " << std::setprecision(4) << fidelity.ssim << ", "
+		<< (fidelity.matchesLeaves ? "matches" : "differs from") << " compression's leaf error" << std::endl;
+}
+
+/*Saves results to a JSON file. Keys are always in the same order, so
+baselines of different runs can be diffed line by line. Values that aren't
+finite are null.*/
+void BatchBenchmark::writeJson(const std::string& path) const {
+	std::ofstream out(path);
+	if (!out)
+		throw std::exception(("Failed to open file " + path + '.').c_str());
+
+	char date[32];
+	const std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	out << std::setprecision(6) << "{" << std::endl
+		<< "  \"date\": \"" << date << "\"," << std::endl
+		<< "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ',' << std::endl
+		<< "  \"files\": " << compressJobs.size() << ',' << std::endl
+		<< "  \"threshold\": " << JsonNumber{ threshold } << ',' << std::endl
+		<< "  \"criterion\": \"" << (criterion == SplitCriterion::VARIANCE ? "variance" : "range") << "\"," << std::endl
+		<< "  \"passes\": [" << std::endl;
+
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		const Pass& pass = passes[i];
+		out << "    {" << std::endl
+			<< "      \"name\": \"" << pass.name << "\"," << std::endl
+			<< "      \"threads\": " << pass.threads << ',' << std::endl
+			<< "      \"files\": " << pass.files << ',' << std::endl
+			<< "      \"failed\": " << pass.failed << ',' << std::endl
+			<< "      \"bytesIn\": " << pass.bytesIn << ',' << std::endl
+			<< "      \"bytesOut\": " << pass.bytesOut << ',' << std::endl
+			<< "      \"seconds\": " << JsonNumber{ pass.seconds } << ',' << std::endl
+			<< "      \"filesPerSecond\": " << JsonNumber{ pass.filesPerSecond } << ',' << std::endl
+			<< "      \"mbPerSecond\": " << JsonNumber{ pass.mbPerSecond } << ',' << std::endl
+			<< "      \"p50Ms\": " << JsonNumber{ pass.p50 } << ',' << std::endl
+			<< "      \"p90Ms\": " << JsonNumber{ pass.p90 } << ',' << std::endl
+			<< "      \"p99Ms\": " << JsonNumber{ pass.p99 } << ',' << std::endl
+			<< "      \"maxMs\": " << JsonNumber{ pass.maxLatency } << ',' << std::endl
+			<< "      \"peakMemory\": " << pass.peakMemory << ',' << std::endl
+			<< "      \"stats\": {" << std::endl
+			<< "        \"decodeSeconds\": " << JsonNumber{ pass.stats.decodeTime } << ',' << std::endl
+			<< "        \"buildSeconds\": " << JsonNumber{ pass.stats.buildTime } << ',' << std::endl
+			<< "        \"encodeSeconds\": " << JsonNumber{ pass.stats.encodeTime } << ',' << std::endl
+			<< "        \"nodes\": " << pass.stats.nodes << ',' << std::endl
+			<< "        \"leaves\": " << pass.stats.leaves << ',' << std::endl
+			<< "        \"maxDepth\": " << pass.stats.maxDepth << ',' << std::endl
+			<< "        \"pixelsScanned\": " << pass.stats.pixelsScanned << ',' << std::endl
+			<< "        \"codecBytesIn\": " << pass.stats.bytesIn << ',' << std::endl
+			<< "        \"codecBytesOut\": " << pass.stats.bytesOut << ',' << std::endl
+			<< "        \"peakScratch\": " << pass.stats.peakScratch << ',' << std::endl
+			<< "        \"squaredError\": " << pass.stats.squaredError << ',' << std::endl
+			<< "        \"samples\": " << pass.stats.samples << std::endl
+			<< "      }" << std::endl
+			<< "    }" << (i + 1 < passes.size() ? "," : "") << std::endl;
+	}
+	out << "  ]," << std::endl
+		<< "  \"estimate\": {" << std::endl
+		<< "    \"files\": " << accuracy.files << ',' << std::endl
+		<< "    \"msPerFile\": " << JsonNumber{ accuracy.msPerFile } << ',' << std::endl
+		<< "    \"bytesErrorPercent\": " << JsonNumber{ accuracy.bytesError } << ',' << std::endl
+		<< "    \"maxBytesErrorPercent\": " << JsonNumber{ accuracy.maxBytesError } << ',' << std::endl
+		<< "    \"nodesErrorPercent\": " << JsonNumber{ accuracy.nodesError } << ',' << std::endl
+		<< "    \"psnr\": " << JsonNumber{ accuracy.psnr } << std::endl
+		<< "  }," << std::endl
+		<< "  \"verify\": {" << std::endl
+		<< "    \"files\": " << fidelity.files << ',' << std::endl
+		<< "    \"msPerFile\": " << JsonNumber{ fidelity.msPerFile } << ',' << std::endl
+		<< "    \"mse\": " << JsonNumber{ fidelity.mse } << ',' << std::endl
+		<< "    \"psnr\": " << JsonNumber{ fidelity.psnr } << ',' << std::endl
+		<< "    \"ssim\": " << JsonNumber{ fidelity.ssim } << ',' << std::endl
+		<< "    \"matchesLeaves\": " << (fidelity.matchesLeaves ? "true" : "false") << std::endl
+		<< "  }" << std::endl << "}" << std::endl;
+}
+
+/*Peak resident memory of the process, in bytes. It never goes down, so
+a pass shows the highest of itself and every pass before it.*/
+unsigned long long BatchBenchmark::peakMemory(void) {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage))
+		return 0;
+#if defined(__APPLE__)
+	return usage.ru_maxrss;
+#else
+	return (unsigned long long)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
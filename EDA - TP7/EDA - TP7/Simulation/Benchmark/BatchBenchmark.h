@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+#include "../QuadTree/CodecStats/CodecStats.h"
+#include "../QuadTree/StatsPyramid/StatsPyramid.h"
+
+/*Measures whole compressAndSave and decompressAndSave batches over a set of
+files, at several thread counts. Each thread has its own QuadTree and takes
+the next file when it's done with one, like a real batch. Estimates of each
+file are then checked against its compressed output, and every output is
+decompressed and compared with its image. Results can be saved as
+a JSON baseline, so runs can be diffed.*/
+class BatchBenchmark {
+public:
+	/*Results of a batch. Latencies are per file, in milliseconds. Peak memory
+	is the process' peak resident size so far, in bytes. Stats are the totals
+	of every file's codec call.*/
+	struct Pass {
+		std::string name;
+		unsigned int threads, files, failed;
+		unsigned long long bytesIn, bytesOut;
+		double seconds, filesPerSecond, mbPerSecond;
+		double p50, p90, p99, maxLatency;
+		unsigned long long peakMemory;
+		CodecStats stats;
+	};
+
+	/*Accuracy of QuadTree::estimate over every file. Errors are in percent of
+	actual values: bytes per file, and nodes of the whole batch. Time is per
+	file, not counting decoding. PSNR is the mean of lossy files.*/
+	struct Accuracy {
+		unsigned int files;
+		double msPerFile, bytesError, maxBytesError, nodesError, psnr;
+	};
+
+	/*Round trip quality of every compressed file against its image. MSE and PSNR
+	are of the whole batch, and SSIM is the mean of files. Time is per file,
+	including decompression. Errors should match the ones compression added up
+	from its leaves.*/
+	struct Fidelity {
+		unsigned int files;
+		double msPerFile, mse, psnr, ssim;
+		bool matchesLeaves;
+	};
+
+	BatchBenchmark(const std::vector<std::string>&, const std::string&, double, SplitCriterion);
+
+	const std::vector<Pass>& run(const std::vector<unsigned int>&, std::ostream&);
+	void print(std::ostream&) const;
+	void writeJson(const std::string&) const;
+
+	static unsigned long long peakMemory(void);
+
+private:
+	/*Input and output file of a batch job.*/
+	using jobVec = std::vector<std::pair<std::string, std::string>>;
+
+	const Pass runPass(const std::string&, unsigned int, const jobVec&, bool) const;
+	const Accuracy runEstimates(unsigned long long) const;
+	const Fidelity runVerification(const CodecStats&) const;
+
+	/*Prevents from using copy constructor.*/
+	BatchBenchmark(const BatchBenchmark&);
+
+	/*Data members.*/
+	/***********************************************/
+	std::vector<Pass> passes;
+	Accuracy accuracy;
+	Fidelity fidelity;
+	jobVec compressJobs, decompressJobs;
+	std::string outDir;
+	double threshold;
+	SplitCriterion criterion;
+	/***********************************************/
+};
@@ -0,0 +1,246 @@
+#include "Benchmark.h"
+#include "../QuadTree/Metrics/Metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+
+/*Benchmark settings. Constants match QuadTree's.*/
+/********************************************/
+namespace {
+	const unsigned int bytesPerPixel = 4;
+	const unsigned int maxDif = 3 * 255;
+	const unsigned char filling = 2;
+	const double bytesPerMB = 1024.0 * 1024.0;
+	const double pi = 3.14159265358979323846;
+
+	/*Side of the blocks fillDecompressedVector fills, as a power of 2.
+	Most leaves of real images are this small.*/
+	const unsigned int fillLog = 2;
+
+	const ImageKind kinds[] = { ImageKind::FLAT, ImageKind::GRADIENT, ImageKind::NOISE, ImageKind::PHOTO };
+	const char* kindNames[] = { "flat", "gradient", "noise", "photo" };
+
+	/*Small deterministic generator, so images are the same on every platform.*/
+	struct Random {
+		uint32_t state;
+
+		uint32_t next(void) {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+	};
+
+	unsigned char clampByte(double value) {
+		return (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+	}
+}
+/********************************************/
+
+/*Benchmark constructor. Sides go from 2^minLog to 2^maxLog.*/
+Benchmark::Benchmark(unsigned int minLog, unsigned int maxLog, const std::vector<double>& thresholds, double seconds) :
+	thresholds(thresholds), minLog(minLog), maxLog(maxLog), seconds(seconds) {}
+
+/*Runs every kernel on every image. Each image is reported to 'log' once measured.*/
+const std::vector<Benchmark::Result>& Benchmark::run(std::ostream& log) {
+	results.clear();
+
+	for (unsigned int n = minLog; n <= maxLog; n++) {
+		for (ImageKind kind : kinds)
+			runImage(kind, 1 << n, log);
+	}
+	return results;
+}
+
+/*Measures every kernel on one synthetic image.*/
+void Benchmark::runImage(ImageKind kind, unsigned int side, std::ostream& log) {
+	const size_t pixels = (size_t)side * side;
+	std::unique_ptr<unsigned char, freeDeleter> image((unsigned char*)malloc(pixels * bytesPerPixel));
+	std::unique_ptr<unsigned char, freeDeleter> output((unsigned char*)malloc(pixels * bytesPerPixel));
+	const unsigned char rgb[bytesPerPixel - 1] = { 10, 20, 30 };
+
+	if (!image || !output)
+		throw std::exception("Not enough memory for benchmark image.");
+
+	synthesize(kind, side, image.get());
+	log << "Measuring " << kindName(kind) << ' ' << side << 'x' << side << "..." << std::endl;
+
+	QuadTree qt;
+
+	/*'output' is lent to qt, and kernels leave decoded trees in it. If a kernel
+	throws, both are handed back before qt is destroyed, so neither is freed twice.*/
+	try {
+		qt.width = side * bytesPerPixel;
+		qt.height = side;
+		qt.realsize = (unsigned int)(pixels * bytesPerPixel);
+
+		/*Threshold check of the whole image, which scans every pixel once.*/
+		qt.threshold = maxDif;
+		add("lessThanThreshold", kind, side, -1, measure([&]() {
+			qt.lessThanThreshold(image.get(), qt.width, side); }));
+
+		/*Fills every block of the image, in tree order.*/
+		const unsigned int blockLog = std::min(fillLog, (unsigned int)std::log2(side));
+		const unsigned int depth = (unsigned int)std::log2(side) - blockLog;
+		qt.outputFile = output.get();
+		add("fillDecompressedVector", kind, side, -1, measure([&]() {
+			std::vector<unsigned int> position(depth);
+			for (size_t block = 0; block < ((size_t)1 << (2 * depth)); block++) {
+				for (unsigned int level = 0; level < depth; level++)
+					position[level] = (block >> (2 * (depth - 1 - level))) & 3;
+				qt.fillDecompressedVector(rgb, position);
+			}
+			}));
+		qt.outputFile = nullptr;
+
+		/*Quality metrics of the image against its filled blocks.*/
+		add("squaredError", kind, side, -1, measure([&]() {
+			Metrics::squaredError(image.get(), output.get(), pixels); }));
+		add("ssim", kind, side, -1, measure([&]() {
+			Metrics::ssim(image.get(), output.get(), side, side); }));
+
+		for (double threshold : thresholds) {
+			std::vector<unsigned char> encoded;
+
+			/*Tree building.*/
+			qt.threshold = threshold * maxDif;
+			qt.width = side * bytesPerPixel;
+			add("compress", kind, side, threshold, measure([&]() {
+				qt.tree.assign(bytesPerPixel, filling);
+				qt.compress(image.get(), qt.width, side);
+				}));
+
+			/*Container encoding of the tree. It only changes the tree's size byte.*/
+			qt.height = side;
+			add("encodeCompressed", kind, side, threshold, measure([&]() {
+				encoded.clear();
+				qt.encodeCompressed(encoded);
+				}));
+
+			/*Container decoding.*/
+			add("decodeCompressed", kind, side, threshold, measure([&]() {
+				qt.decodeCompressed(encoded);
+				qt.freeDecompressed(false);
+				}));
+
+			/*Tree walk, with its fills, on an already decoded tree.*/
+			qt.decodeCompressed(encoded);
+			qt.outputFile = output.get();
+			add("decompress", kind, side, threshold, measure([&]() {
+				unsigned char* substitute = qt.inputFile;
+				qt.decompress(&substitute);
+				}));
+			qt.freeDecompressed(false);
+		}
+	}
+	catch (...) {
+		qt.freeDecompressed(false);
+		throw;
+	}
+}
+
+/*Saves a kernel's timing, given in seconds per run over the whole image.*/
+void Benchmark::add(const std::string& kernel, ImageKind kind, unsigned int side, double threshold, double time) {
+	const double pixels = (double)side * side;
+	results.push_back({ kernel, kind, side, threshold, time * 1e9 / pixels, time > 0 ? pixels * bytesPerPixel / bytesPerMB / time : 0 });
+}
+
+/*Runs 'kernel' until 'seconds' have passed, at least once after a warm up run.
+Returns average seconds per run.*/
+template <class F>
+double Benchmark::measure(const F& kernel) const {
+	using clock = std::chrono::steady_clock;
+	unsigned int runs = 0;
+
+	kernel();
+
+	const clock::time_point start = clock::now();
+	double elapsed = 0;
+	do {
+		kernel();
+		runs++;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	} while (elapsed < seconds);
+
+	return elapsed / runs;
+}
+
+/*Prints results as a table.*/
+void Benchmark::print(std::ostream& out) const {
+	out << std::left << std::setw(24) << "kernel" << std::setw(10) << "image" << std::right << std::setw(8) << "side"
+		<< std::setw(11) << "threshold" << std::setw(12) << "ns/pixel" << std::setw(12) << "MB/s" << std::endl;
+
+	for (const auto& result : results) {
+		out << std::left << std::setw(24) << result.kernel << std::setw(10) << kindName(result.kind) << std::right << std::setw(8) << result.side;
+		if (result.threshold < 0)
+			out << std::setw(11) << '-';
+		else
+			out << std::setw(11) << std::fixed << std::setprecision(3) << result.threshold;
+		out << std::setw(12) << std::fixed << std::setprecision(3) << result.nsPerPixel
+			<< std::setw(12) << std::setprecision(1) << result.mbPerSecond << std::endl;
+	}
+}
+
+/*Returns name of an image kind.*/
+const char* Benchmark::kindName(ImageKind kind) { return kindNames[(int)kind]; }
+
+/*Fills 'out' with a square RGBA image of the given kind and side.
+Images of the same kind and side differ by 'seed'.*/
+void Benchmark::synthesize(ImageKind kind, unsigned int side, unsigned char* out, unsigned int seed) {
+	Random random = { 2463534242u + seed * 2654435761u };
+	if (!random.state)
+		random.state = 1;
+
+	/*Photographic images get a few shapes with hard edges.*/
+	struct Shape {
+		double x, y, radius, shade[bytesPerPixel - 1];
+	} shapes[6];
+	for (auto& shape : shapes) {
+		shape.x = random.next() % side;
+		shape.y = random.next() % side;
+		shape.radius = side / 16.0 + random.next() % (side / 4 + 1);
+		for (auto& shade : shape.shade)
+			shade = (double)(random.next() % 121) - 60;
+	}
+
+	for (unsigned int row = 0; row < side; row++) {
+		for (unsigned int col = 0; col < side; col++) {
+			unsigned char* pixel = out + ((size_t)row * side + col) * bytesPerPixel;
+			const double u = (double)col / side, v = (double)row / side;
+
+			for (unsigned int c = 0; c < bytesPerPixel - 1; c++) {
+				switch (kind) {
+				case ImageKind::FLAT:
+					pixel[c] = (unsigned char)(60 + 70 * c);
+					break;
+				case ImageKind::GRADIENT:
+					pixel[c] = clampByte(255 * (c == 0 ? u : c == 1 ? v : (u + v) / 2));
+					break;
+				case ImageKind::NOISE:
+					pixel[c] = (unsigned char)random.next();
+					break;
+
+				/*Smooth lighting, texture at a few scales, shapes and sensor noise.*/
+				case ImageKind::PHOTO: {
+					double value = 110 + 60 * std::sin(2 * pi * (u * (1 + c) + v * 0.7)) * std::cos(2 * pi * v * 1.3)
+						+ 12 * std::sin(2 * pi * u * 23 + c) * std::sin(2 * pi * v * 17)
+						+ (double)(random.next() % 9) - 4;
+
+					for (const auto& shape : shapes) {
+						if ((col - shape.x) * (col - shape.x) + (row - shape.y) * (row - shape.y) < shape.radius * shape.radius)
+							value += shape.shade[c];
+					}
+					pixel[c] = clampByte(value);
+					break;
+				}
+				}
+			}
+			pixel[bytesPerPixel - 1] = 255;
+		}
+	}
+}
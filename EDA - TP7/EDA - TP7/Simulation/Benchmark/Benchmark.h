@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+#include "../QuadTree/QuadTree.h"
+
+/*Synthetic image kinds.*/
+/********************************/
+enum class ImageKind : int {
+	FLAT = 0,
+	GRADIENT,
+	NOISE,
+	PHOTO
+};
+/********************************/
+
+/*Measures QuadTree's compression and decompression kernels one by one, on
+synthetic images of every kind, at every side from 2^minLog to 2^maxLog and
+at every threshold. Each kernel is repeated for at least 'seconds'. Timings
+are given in nanoseconds per image pixel and image megabytes (RGBA) per
+second, so kernels working on different data can be compared.*/
+class Benchmark {
+public:
+	/*Timing of a kernel. Threshold is negative for kernels that don't depend on it.*/
+	struct Result {
+		std::string kernel;
+		ImageKind kind;
+		unsigned int side;
+		double threshold, nsPerPixel, mbPerSecond;
+	};
+
+	Benchmark(unsigned int, unsigned int, const std::vector<double>&, double);
+
+	const std::vector<Result>& run(std::ostream&);
+	void print(std::ostream&) const;
+
+	static const char* kindName(ImageKind);
+	static void synthesize(ImageKind, unsigned int, unsigned char*, unsigned int = 0);
+
+private:
+	void runImage(ImageKind, unsigned int, std::ostream&);
+	void add(const std::string&, ImageKind, unsigned int, double, double);
+
+	template <class F>
+	double measure(const F&) const;
+
+	/*Prevents from using copy constructor.*/
+	Benchmark(const Benchmark&);
+
+	/*Data members.*/
+	/***********************************************/
+	std::vector<Result> results;
+	std::vector<double> thresholds;
+	unsigned int minLog, maxLog;
+	double seconds;
+	/***********************************************/
+};
@@ -0,0 +1,82 @@
+#include "Corpus.h"
+#include "../QuadTree/Codec/Codec.h"
+#include <boost/filesystem.hpp>
+#include <random>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <cstdlib>
+
+namespace {
+	const unsigned int bytesPerPixel = 4;
+	const unsigned int kindCount = 4;
+}
+
+/*Corpus constructor. 'mix' has a weight for each image kind.*/
+Corpus::Corpus(unsigned int count, unsigned int minLog, unsigned int maxLog, const std::vector<double>& mix, unsigned int seed) :
+	mix(mix), count(count), minLog(minLog), maxLog(std::max(minLog, maxLog)), seed(seed) {
+	if (this->mix.size() != kindCount)
+		throw std::exception("Corpus needs a weight for each image kind.");
+}
+
+/*Writes every image to 'dir', which is created if needed, encoded in the
+given format. Names tell index, kind and side. Returns written paths.*/
+const std::vector<std::string> Corpus::generate(const std::string& dir, const std::string& format) const {
+	std::vector<std::string> result;
+	const Codec& codec = Codec::get(format);
+
+	boost::filesystem::create_directories(dir);
+
+	/*Only standard distributions whose output is fixed by the standard are used,
+	so sets are the same everywhere.*/
+	std::mt19937 random(seed);
+	double total = 0;
+	for (double weight : mix)
+		total += weight;
+	if (total <= 0)
+		throw std::exception("Corpus mix has no positive weight.");
+
+	for (unsigned int i = 0; i < count; i++) {
+		/*Draws kind and side.*/
+		double pick = random() / (random.max() + 1.0) * total;
+		unsigned int kind = 0;
+		while (kind + 1 < kindCount && pick >= mix[kind])
+			pick -= mix[kind++];
+		const unsigned int side = 1 << (minLog + random() % (maxLog - minLog + 1));
+
+		std::unique_ptr<unsigned char, freeDeleter> pixels((unsigned char*)malloc((size_t)side * side * bytesPerPixel));
+		if (!pixels)
+			throw std::exception("Not enough memory for corpus image.");
+		Benchmark::synthesize((ImageKind)kind, side, pixels.get(), seed + i);
+
+		std::vector<unsigned char> encoded;
+		codec.encode(encoded, pixels.get(), side, side);
+
+		std::ostringstream name;
+		name << "img-" << std::setw(5) << std::setfill('0') << i << '-' << Benchmark::kindName((ImageKind)kind) << '-' << side << '.' << Codec::extension('.' + format);
+		result.push_back((boost::filesystem::path(dir) / name.str()).string());
+		Codec::writeFile(result.back(), encoded);
+	}
+	return result;
+}
+
+/*Parses a list of 'kind:weight' pairs separated by commas, such as
+"flat:1,photo:4". Kinds that are not listed get no weight.*/
+const std::vector<double> Corpus::parseMix(const std::string& text) {
+	std::vector<double> result(kindCount, 0);
+	std::stringstream list(text);
+	std::string item;
+
+	while (std::getline(list, item, ',')) {
+		const size_t colon = item.find(':');
+		unsigned int kind = 0;
+
+		while (kind < kindCount && item.substr(0, colon) != Benchmark::kindName((ImageKind)kind))
+			kind++;
+		if (kind == kindCount || colon == std::string::npos)
+			throw std::exception(("Unknown corpus mix item: " + item).c_str());
+		result[kind] = std::stod(item.substr(colon + 1));
+	}
+	return result;
+}
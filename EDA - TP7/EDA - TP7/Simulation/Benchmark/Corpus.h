@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+
+/*Writes a reproducible set of synthetic images, for batch benchmarks. Each
+image gets a random kind, drawn with the given weights, which sets how much
+entropy it has, and a random side from 2^minLog to 2^maxLog. The same seed
+always gives the same set.*/
+class Corpus {
+public:
+	Corpus(unsigned int, unsigned int, unsigned int, const std::vector<double>&, unsigned int);
+
+	const std::vector<std::string> generate(const std::string&, const std::string&) const;
+
+	static const std::vector<double> parseMix(const std::string&);
+
+private:
+	/*Data members.*/
+	/***********************************************/
+	std::vector<double> mix;
+	unsigned int count, minLog, maxLog, seed;
+	/***********************************************/
+};
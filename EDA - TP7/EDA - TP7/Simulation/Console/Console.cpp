@@ -0,0 +1,302 @@
+#include "Console.h"
+#include "../QuadTree/Codec/Codec.h"
+#include "../QuadTree/Estimator/Estimator.h"
+#include "../QuadTree/Metrics/Metrics.h"
+#include "../Benchmark/Benchmark.h"
+#include "../Benchmark/Corpus.h"
+#include "../Benchmark/BatchBenchmark.h"
+#include "../Trace/Trace.h"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+/*Default values for options not given by user.*/
+/********************************************/
+namespace {
+	const char* defaultFormat = "EDA";
+	const char* defaultThreshold = "0.1";
+
+	/*Split criteria, in SplitCriterion's order.*/
+	const char* criterionNames[] = { "range", "variance" };
+	const char* defaultCriterion = "range";
+
+	/*Benchmark defaults. Sides are powers of 2. Images of side 2^14 need
+	several gigabytes, so they're only measured if asked for.*/
+	const char* defaultMinLog = "6";
+	const char* defaultMaxLog = "12";
+	const char* defaultThresholds = "0.01,0.1,0.3";
+	const char* defaultSeconds = "0.2";
+
+	/*Corpus and batch benchmark defaults.*/
+	const char* defaultCount = "200";
+	const char* defaultCorpusMinLog = "6";
+	const char* defaultCorpusMaxLog = "10";
+	const char* defaultMix = "flat:1,gradient:1,noise:1,photo:4";
+	const char* defaultSeed = "1";
+	const char* defaultCorpusFormat = "png";
+	const char* defaultThreads = "1,2,4,8";
+	const char* benchOutput = "bench-out";
+}
+/********************************************/
+
+/*Console constructor. Splits arguments into positional
+ones and options of the form '--name value'.*/
+Console::Console(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+
+		if (arg.length() > 2 && arg.substr(0, 2) == "--") {
+			options.push_back({ arg.substr(2), i + 1 < argc ? argv[i + 1] : "" });
+			i++;
+		}
+		else
+			positional.push_back(arg);
+	}
+
+	qt.setFormat(option("format", defaultFormat));
+}
+
+/*Runs requested command. Messages go to stderr, as stdout may be carrying data.
+If '--trace' is given, spans of the whole command are written to that file.*/
+int Console::run(void) {
+	int result = -1;
+	const std::string trace = option("trace", "");
+
+	if (trace.length())
+		Trace::start();
+
+	try {
+		qt.setCriterion(criterion());
+
+		if (positional.size() == 3 && positional[0] == "compress") {
+			compress();
+			result = 0;
+		}
+		else if (positional.size() == 3 && positional[0] == "decompress") {
+			decompress();
+			result = 0;
+		}
+		else if (positional.size() == 2 && positional[0] == "estimate") {
+			estimate();
+			result = 0;
+		}
+		else if (positional.size() == 3 && positional[0] == "verify") {
+			verify();
+			result = 0;
+		}
+		else if (positional.size() == 1 && positional[0] == "bench") {
+			bench();
+			result = 0;
+		}
+		else if (positional.size() == 2 && positional[0] == "corpus") {
+			corpus();
+			result = 0;
+		}
+		else if (positional.size() == 2 && positional[0] == "batch-bench") {
+			batchBench();
+			result = 0;
+		}
+		else
+			usage();
+	}
+
+	/*Exception handler.*/
+	catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+	}
+
+	if (trace.length()) {
+		Trace::stop();
+		try {
+			Trace::write(trace);
+		}
+		catch (std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			result = -1;
+		}
+	}
+	return result;
+}
+
+/*Compresses input to output. Input format is taken from its extension
+or, for stdin and existing files without extension, detected from its data.
+Other names without extension get the image format appended.
+If '--thresholds' is given, one output is written for each of them. If
+'--max-bytes' or '--min-psnr' is given, threshold is searched to meet it.*/
+void Console::compress(void) {
+	const std::vector<std::string> tiers = optionList("thresholds", "");
+	const std::string maxBytes = option("max-bytes", ""), minPSNR = option("min-psnr", "");
+
+	if (maxBytes.length() || minPSNR.length()) {
+		const double threshold = maxBytes.length() ? qt.compressAndSave(positional[1], positional[2], TargetMode::SIZE, std::stod(maxBytes))
+			: qt.compressAndSave(positional[1], positional[2], TargetMode::PSNR, std::stod(minPSNR));
+		std::cerr << "Threshold: " << threshold << std::endl;
+		qt.getStats().print(std::cerr);
+		return;
+	}
+	if (tiers.empty()) {
+		qt.compressAndSave(positional[1], positional[2], std::stod(option("threshold", defaultThreshold)));
+		return;
+	}
+
+	std::vector<double> thresholds;
+	for (const auto& threshold : tiers)
+		thresholds.push_back(std::stod(threshold));
+
+	qt.compressAndSave(positional[1], positional[2], thresholds);
+	if (thresholds.size() > 1) {
+		for (double threshold : thresholds)
+			std::cerr << qt.tierName(positional[2], threshold) << std::endl;
+	}
+	qt.getStats().print(std::cerr);
+}
+
+/*Decompresses input to output. Image format is taken from '--image',
+or from output's extension if that option was not given.*/
+void Console::decompress(void) {
+	const std::string image = option("image", Codec::extension(positional[2]));
+
+	if (image.length())
+		qt.setImageFormat(image);
+
+	qt.decompressAndSave(positional[1], positional[2]);
+}
+
+/*Estimates compressed size and PSNR of input at each of '--thresholds', and
+prints a table of results to stdout. Image is decoded only once.*/
+void Console::estimate(void) {
+	const std::string input = qt.parseImage(positional[1]);
+	std::vector<unsigned char> data;
+	std::vector<double> thresholds;
+
+	for (const auto& threshold : optionList("thresholds", defaultThresholds))
+		thresholds.push_back(std::stod(threshold));
+
+	Codec::readFile(input, data);
+	const std::vector<Estimate> estimates = qt.estimate(data, Codec::extension(input), thresholds);
+
+	std::cout << std::setw(10) << "threshold" << std::setw(14) << "nodes" << std::setw(14) << "bytes" << std::setw(10) << "PSNR dB"
+		<< std::setw(12) << "tiles" << std::setw(10) << "ms" << std::endl;
+	for (unsigned int i = 0; i < estimates.size(); i++) {
+		const Estimate& estimate = estimates[i];
+		std::cout << std::fixed << std::setprecision(3) << std::setw(10) << thresholds[i] << std::setprecision(0) << std::setw(14) << estimate.nodes
+			<< std::setw(14) << estimate.bytes << std::setprecision(2) << std::setw(10) << estimate.psnr
+			<< std::setw(12) << (std::to_string(estimate.sampledTiles) + '/' + std::to_string(estimate.reachedTiles))
+			<< std::setw(10) << estimate.seconds * 1000 << std::endl;
+	}
+}
+
+/*Decompresses a compressed file and compares it with the image it was compressed
+from, printing MSE, PSNR and SSIM to stdout. Image format is taken as in compress.*/
+void Console::verify(void) {
+	const std::string image = qt.parseImage(positional[1]);
+	std::vector<unsigned char> original, compressed;
+
+	Codec::readFile(image, original);
+	Codec::readFile(qt.parse(positional[2], qt.getFormat()), compressed);
+	const Quality quality = qt.verify(original, Codec::extension(image), compressed);
+
+	std::cout << std::fixed << std::setprecision(4) << "MSE " << quality.mse << ", PSNR " << std::setprecision(2)
+		<< quality.psnr << " dB, SSIM " << std::setprecision(4) << quality.ssim << std::endl;
+}
+
+/*Measures compression and decompression kernels and prints a table of results
+to stdout. Progress goes to stderr.*/
+void Console::bench(void) {
+	std::vector<double> thresholds;
+	for (const auto& threshold : optionList("thresholds", defaultThresholds))
+		thresholds.push_back(std::stod(threshold));
+
+	Benchmark benchmark(std::stoi(option("min-log", defaultMinLog)), std::stoi(option("max-log", defaultMaxLog)),
+		thresholds, std::stod(option("seconds", defaultSeconds)));
+	benchmark.run(std::cerr);
+	benchmark.print(std::cout);
+}
+
+/*Writes a synthetic image corpus to the given directory.*/
+void Console::corpus(void) {
+	Corpus set(std::stoi(option("count", defaultCount)), std::stoi(option("min-log", defaultCorpusMinLog)),
+		std::stoi(option("max-log", defaultCorpusMaxLog)), Corpus::parseMix(option("mix", defaultMix)), std::stoi(option("seed", defaultSeed)));
+
+	std::cerr << set.generate(positional[1], option("image", defaultCorpusFormat)).size() << " images written to " << positional[1] << std::endl;
+}
+
+/*Compresses and decompresses every image in the given directory at each thread
+count, and prints a table of results to stdout. Outputs go to a subdirectory.
+Results are also saved to '--json', if given.*/
+void Console::batchBench(void) {
+	std::vector<std::string> files;
+	std::vector<unsigned int> threads;
+	boost::system::error_code ec;
+
+	for (boost::filesystem::directory_iterator itr(positional[1], ec); !ec && itr != boost::filesystem::directory_iterator(); itr.increment(ec)) {
+		const std::string ext = Codec::extension(itr->path().string());
+		if (boost::filesystem::is_regular_file(itr->status()) && ext.length() && Codec::exists(ext))
+			files.push_back(itr->path().string());
+	}
+	if (ec || files.empty())
+		throw std::exception(("No images found in " + positional[1] + '.').c_str());
+	std::sort(files.begin(), files.end());
+
+	for (const auto& count : optionList("threads", defaultThreads))
+		threads.push_back(std::stoi(count));
+
+	BatchBenchmark benchmark(files, option("out", (boost::filesystem::path(positional[1]) / benchOutput).string()),
+		std::stod(option("threshold", defaultThreshold)), criterion());
+	benchmark.run(threads, std::cerr);
+	benchmark.print(std::cout);
+
+	const std::string json = option("json", "");
+	if (json.length())
+		benchmark.writeJson(json);
+}
+
+/*Prints usage to stderr.*/
+void Console::usage(void) const {
+	std::cerr << "Usage:" << std::endl
+		<< "  compress <input|-> <output|-> [--threshold t | --thresholds t1,t2,... | --max-bytes n | --min-psnr db] [--format ext]" << std::endl
+		<< "  decompress <input|-> <output|-> [--image ext] [--format ext]" << std::endl
+		<< "  estimate <input|-> [--thresholds t1,t2,...]" << std::endl
+		<< "  verify <image> <compressed> [--format ext]" << std::endl
+		<< "  bench [--min-log n] [--max-log n] [--thresholds t1,t2,...] [--seconds s]" << std::endl
+		<< "  corpus <dir> [--count n] [--min-log n] [--max-log n] [--mix kind:weight,...] [--seed s] [--image ext]" << std::endl
+		<< "  batch-bench <dir> [--threads n1,n2,...] [--threshold t] [--out dir] [--json file]" << std::endl
+		<< "Every command takes [--trace file] to save a Chrome trace of its run." << std::endl
+		<< "compress, estimate and batch-bench take [--criterion range|variance] to choose how nodes are split." << std::endl
+		<< "'-' reads from stdin or writes to stdout." << std::endl
+		<< "Images without extension are detected from their data if they exist, or else taken as .png." << std::endl
+		<< "Corpus image kinds are flat, gradient, noise and photo." << std::endl;
+}
+
+/*Returns split criterion given by '--criterion'. Range is the default.*/
+SplitCriterion Console::criterion(void) const {
+	const std::string name = option("criterion", defaultCriterion);
+
+	for (int i = 0; i < 2; i++) {
+		if (name == criterionNames[i])
+			return (SplitCriterion)i;
+	}
+	throw std::exception(("Unknown split criterion " + name + '.').c_str());
+}
+
+/*Returns value of option 'name', or 'def' if it was not given.*/
+const std::string Console::option(const std::string& name, const std::string& def) const {
+	for (const auto& opt : options) {
+		if (opt.first == name)
+			return opt.second;
+	}
+	return def;
+}
+
+/*Returns comma separated values of option 'name', or of 'def' if it was not given.*/
+const std::vector<std::string> Console::optionList(const std::string& name, const std::string& def) const {
+	std::vector<std::string> result;
+	std::stringstream list(option(name, def));
+	std::string item;
+
+	while (std::getline(list, item, ','))
+		result.push_back(item);
+	return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "../QuadTree/QuadTree.h"
+
+/*Command line front end. Runs a single compression, decompression or
+estimate, a round trip check, or one of the benchmarks, without GUI. Input and output can be '-' to use stdin and stdout, so
+it can be used as a stage in shell pipelines.*/
+class Console {
+public:
+	Console(int, char**);
+
+	int run(void);
+
+private:
+	void compress(void);
+	void decompress(void);
+	void estimate(void);
+	void verify(void);
+	void bench(void);
+	void corpus(void);
+	void batchBench(void);
+	void usage(void) const;
+
+	SplitCriterion criterion(void) const;
+	const std::string option(const std::string&, const std::string&) const;
+	const std::vector<std::string> optionList(const std::string&, const std::string&) const;
+
+	/*Prevents from using copy constructor.*/
+	Console(const Console&);
+
+	/*Data members.*/
+	/***************************************/
+	std::vector<std::string> positional;
+	std::vector<std::pair<std::string, std::string>> options;
+	QuadTree qt;
+	/***************************************/
+};
@@ -0,0 +1,160 @@
+#include "DirWatcher.h"
+#include <boost/filesystem.hpp>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+namespace {
+	/*Size of the buffer the OS fills with change records.*/
+	const unsigned int bufferSize = 64 * 1024;
+}
+
+#if defined(_WIN32)
+struct DirWatcher::Handles {
+	HANDLE dir = INVALID_HANDLE_VALUE;
+	OVERLAPPED overlapped = {};
+	alignas(DWORD) char buffer[bufferSize];
+
+	/*Asks for the next batch of changes. Results are collected in poll.*/
+	bool request(void) {
+		return ReadDirectoryChangesW(dir, buffer, bufferSize, FALSE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+			nullptr, &overlapped, nullptr);
+	}
+};
+#elif defined(__linux__)
+struct DirWatcher::Handles {
+	int fd = -1, wd = -1;
+	alignas(inotify_event) char buffer[bufferSize];
+};
+#else
+struct DirWatcher::Handles {};
+#endif
+
+/*DirWatcher constructor. Nothing is watched yet.*/
+DirWatcher::DirWatcher() : handles(new Handles) {}
+
+/*Starts watching 'path', instead of the previously watched directory.
+If watching fails, poll reports nothing.*/
+void DirWatcher::watch(const std::string& path) {
+	stop();
+
+#if defined(_WIN32)
+	handles->dir = CreateFileW(boost::filesystem::path(path).wstring().c_str(), FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+	if (handles->dir != INVALID_HANDLE_VALUE) {
+		handles->overlapped = {};
+		handles->overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		if (!handles->overlapped.hEvent || !handles->request())
+			stop();
+	}
+#elif defined(__linux__)
+	if ((handles->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) >= 0) {
+		handles->wd = inotify_add_watch(handles->fd, path.c_str(),
+			IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR);
+		if (handles->wd < 0)
+			stop();
+	}
+#endif
+}
+
+/*Stops watching current directory.*/
+void DirWatcher::stop(void) {
+#if defined(_WIN32)
+	if (handles->dir != INVALID_HANDLE_VALUE) {
+		CancelIo(handles->dir);
+		CloseHandle(handles->dir);
+		handles->dir = INVALID_HANDLE_VALUE;
+	}
+	if (handles->overlapped.hEvent) {
+		CloseHandle(handles->overlapped.hEvent);
+		handles->overlapped.hEvent = nullptr;
+	}
+#elif defined(__linux__)
+	if (handles->fd >= 0)
+		close(handles->fd);
+	handles->fd = -1;
+	handles->wd = -1;
+#endif
+}
+
+/*Appends changes since last call to 'changes', without blocking.
+Returns false if changes were lost and the directory must be rescanned.*/
+bool DirWatcher::poll(std::vector<DirChange>& changes) {
+#if defined(_WIN32)
+	DWORD bytes;
+
+	if (handles->dir == INVALID_HANDLE_VALUE)
+		return true;
+
+	while (GetOverlappedResult(handles->dir, &handles->overlapped, &bytes, FALSE)) {
+		/*No bytes means buffer overflowed.*/
+		if (!bytes) {
+			handles->request();
+			return false;
+		}
+
+		for (char* pos = handles->buffer;;) {
+			const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)pos;
+			DirChange change;
+
+			change.name = boost::filesystem::path(std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR))).string();
+			if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+				change.kind = DirChange::ADDED;
+			else if (info->Action == FILE_ACTION_REMOVED || info->Action == FILE_ACTION_RENAMED_OLD_NAME)
+				change.kind = DirChange::REMOVED;
+			else
+				change.kind = DirChange::MODIFIED;
+			changes.push_back(change);
+
+			if (!info->NextEntryOffset)
+				break;
+			pos += info->NextEntryOffset;
+		}
+
+		ResetEvent(handles->overlapped.hEvent);
+		if (!handles->request())
+			return false;
+	}
+#elif defined(__linux__)
+	ssize_t length;
+
+	if (handles->fd < 0)
+		return true;
+
+	while ((length = read(handles->fd, handles->buffer, bufferSize)) > 0) {
+		for (char* pos = handles->buffer; pos < handles->buffer + length;) {
+			const inotify_event* event = (const inotify_event*)pos;
+			pos += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+				return false;
+			if (!event->len)
+				continue;
+
+			DirChange change;
+			change.name = event->name;
+			if (event->mask & (IN_CREATE | IN_MOVED_TO))
+				change.kind = DirChange::ADDED;
+			else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+				change.kind = DirChange::REMOVED;
+			else
+				change.kind = DirChange::MODIFIED;
+			changes.push_back(change);
+		}
+	}
+#endif
+	return true;
+}
+
+/*DirWatcher destructor. Stops watching.*/
+DirWatcher::~DirWatcher() {
+	stop();
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+
+/*Change to a watched directory's entry.*/
+struct DirChange {
+	enum Kind { ADDED, REMOVED, MODIFIED };
+	Kind kind;
+	std::string name;
+};
+
+/*Watches a single directory for added, removed and modified entries without
+walking it. Uses inotify on Linux and ReadDirectoryChangesW on Windows.
+Elsewhere nothing is ever reported, so listings only change on rescans.*/
+class DirWatcher {
+public:
+	DirWatcher();
+	~DirWatcher();
+
+	void watch(const std::string&);
+	void stop(void);
+
+	bool poll(std::vector<DirChange>&);
+
+private:
+	/*Prevents from using copy constructor.*/
+	DirWatcher(const DirWatcher&);
+
+	/*Platform specific handles.*/
+	struct Handles;
+	std::unique_ptr<Handles> handles;
+};
@@ -1,9 +1,41 @@
 #include "Filesystem.h"
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace {
+	/*Lister publishes found entries after this many, or after this many
+	milliseconds, whichever comes first.*/
+	const unsigned int batchSize = 512;
+	const unsigned int batchTime = 50;
+
+	/*Fills 'entry' with the metadata of 'p', given its status.
+	Returns false if it's neither a directory nor a regular file.*/
+	bool makeEntry(const boost::filesystem::path& p, const boost::filesystem::file_status& status, FileEntry& entry) {
+		boost::system::error_code ec;
+
+		entry.isDir = boost::filesystem::is_directory(status);
+		if (!entry.isDir && !boost::filesystem::is_regular_file(status))
+			return false;
+
+		entry.name = p.filename().string();
+		entry.fullPath = p.string();
+		entry.extension = p.extension().string();
+		entry.size = entry.isDir ? 0 : boost::filesystem::file_size(p, ec);
+		if (ec)
+			entry.size = 0;
+		entry.mtime = boost::filesystem::last_write_time(p, ec);
+		if (ec)
+			entry.mtime = 0;
+
+		return true;
+	}
+}
 
 /*Filesystem constructor. Sets path to current path
-and loads this->path_content.*/
-Filesystem::Filesystem() {
+and starts loading this->path_content.*/
+Filesystem::Filesystem() : listing(false), cancelled(false), nextId(0), generation(0) {
 	mustUpdate = true;
 
 	/*Loads vector and string with content.*/
@@ -12,20 +44,19 @@ Filesystem::Filesystem() {
 
 /*Returns the contents of the given path. If none is given,
 it returns the contents of this->path. In both cases, if the variadic
-arguments are given, it filters files by format type of said arguments.*/
-const strVec& Filesystem::pathContent(const char* imgPath, bool force, const variadicArgs& acceptedFormats)
+arguments are given, it filters files by format type of said arguments.
+Each entry's metadata is read here, so callers never stat files themselves.
+Directory is only walked when path changes or when forced, on a background
+thread, so the returned content fills in over the following calls. Otherwise,
+the cached listing is kept up to date by the watcher and filtered again if
+formats changed.*/
+const entryVec& Filesystem::pathContent(const char* imgPath, bool force, const variadicArgs& acceptedFormats)
 {
 	/*If mustUpdate is true, then path changed recently from another method.
 	If force is true, then the caller is forcing to reaload file info from path.
 	If imgPath is null or equal to this->path, then it doesn't reaload files because
 	they are already in this->path_content.*/
 	if (mustUpdate || force || (imgPath && (imgPath != path))) {
-		std::map<std::string, int> formats;
-
-		/*Gets format arguments (if any were given).*/
-		for (const auto& format : acceptedFormats)
-			formats[format] = 1;
-
 		/*Toggles mustUpdate.*/
 		if (mustUpdate) mustUpdate = !mustUpdate;
 
@@ -49,30 +80,146 @@ const strVec& Filesystem::pathContent(const char* imgPath, bool force, const var
 
 		/*If the given path was correct and it is a directory...*/
 		if (boost::filesystem::exists(p) && boost::filesystem::is_directory(p)) {
-			/*Clears file vector.*/
-			path_content.clear();
-
-			bool loadCondition;
-			/*Loops for every file/directory in path. If it's a directory, it saves
-			it to path_content. If it's a file and its format is has been passed as
-			argument, it saves it to path_content. Otherwise, it skips it.*/
-			for (boost::filesystem::directory_iterator itr(p); itr != boost::filesystem::directory_iterator(); itr++) {
-				/*Checks if it's either directory or a file with format given as argument.*/
-				loadCondition = isDir(itr->path().string().c_str()) ||
-					(isFile(itr->path().string().c_str()) && formats.find(itr->path().extension().string()) != formats.end());
-
-				if (loadCondition)
-					path_content.push_back(itr->path().filename().string());
-			}
-
-			/*Updates current path.*/
+			/*Updates current path and starts walking it.*/
 			path = p.string();
+			scan(path);
+			filter(acceptedFormats);
 		}
 	}
 
+	/*Applies changes since last call, and filters again if formats changed.*/
+	else {
+		update();
+		if (acceptedFormats != formats)
+			filter(acceptedFormats);
+	}
+
 	/*Returns file vector.*/
 	return path_content;
 }
+
+/*Merges entries found by the lister and applies changes reported
+by the watcher to the cached listing. Returns true if listing changed.*/
+bool Filesystem::update(void) {
+	std::vector<DirChange> changes;
+	entryVec batch;
+
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		batch.swap(found);
+	}
+
+	/*Entries already loaded by the watcher are newer than the listed ones.*/
+	for (auto& entry : batch) {
+		if (!removed.count(entry.name))
+			entries.emplace(entry.name, std::move(entry));
+	}
+
+	/*If changes were lost, walks directory again.*/
+	if (!watcher.poll(changes)) {
+		scan(path);
+		filter(formats);
+		return true;
+	}
+
+	for (const auto& change : changes) {
+		if (change.kind == DirChange::REMOVED) {
+			entries.erase(change.name);
+			removed.insert(change.name);
+		}
+		else
+			load(change.name);
+	}
+
+	if (batch.size() || changes.size())
+		filter(formats);
+
+	return batch.size() || changes.size();
+}
+
+/*Starts walking 'dir' on the lister thread and watching it.
+Any listing still running is cancelled. Entry ids start over.*/
+void Filesystem::scan(const std::string& dir) {
+	stopListing();
+	nextId = 0;
+	generation++;
+
+	/*Starts watching before walking, so no change is missed in between.*/
+	watcher.watch(dir);
+	entries.clear();
+	removed.clear();
+	found.clear();
+
+	cancelled = false;
+	listing = true;
+	lister = std::thread(&Filesystem::list, this, dir);
+}
+
+/*Lister thread. Loops for every file/directory in 'dir', publishing
+them in batches. Entry status comes from the directory listing itself.*/
+void Filesystem::list(const std::string& dir) {
+	boost::system::error_code ec;
+	entryVec batch;
+	FileEntry entry;
+	auto last = std::chrono::steady_clock::now();
+
+	/*Moves batch to 'found', where update will pick it up.*/
+	const auto publish = [this, &batch, &last]() {
+		std::lock_guard<std::mutex> lock(mtx);
+		std::move(batch.begin(), batch.end(), std::back_inserter(found));
+		batch.clear();
+		last = std::chrono::steady_clock::now();
+	};
+
+	for (boost::filesystem::directory_iterator itr(dir, ec); !ec && !cancelled && itr != boost::filesystem::directory_iterator(); itr.increment(ec)) {
+		if (makeEntry(itr->path(), itr->status(ec), entry)) {
+			entry.id = nextId++;
+			batch.push_back(entry);
+		}
+
+		if (batch.size() >= batchSize || std::chrono::steady_clock::now() - last > std::chrono::milliseconds(batchTime))
+			publish();
+	}
+	publish();
+	listing = false;
+}
+
+/*Cancels running listing and waits for lister thread to end.*/
+void Filesystem::stopListing(void) {
+	cancelled = true;
+	if (lister.joinable())
+		lister.join();
+}
+
+/*Reads metadata of a single entry in path, after it was added or modified.
+Modified entries keep their id.*/
+void Filesystem::load(const std::string& name) {
+	boost::system::error_code ec;
+	const boost::filesystem::path p = boost::filesystem::path(path) / name;
+	FileEntry entry;
+
+	if (makeEntry(p, boost::filesystem::status(p, ec), entry)) {
+		auto itr = entries.find(name);
+		entry.id = itr != entries.end() ? itr->second.id : nextId++;
+		entries[name] = entry;
+		removed.erase(name);
+	}
+	else
+		entries.erase(name);
+}
+
+/*Rebuilds path_content from cached entries. Directories are always
+kept, files only if their format is one of 'acceptedFormats'.*/
+void Filesystem::filter(const variadicArgs& acceptedFormats) {
+	formats = acceptedFormats;
+	path_content.clear();
+
+	for (const auto& entry : entries) {
+		if (entry.second.isDir || std::find(formats.begin(), formats.end(), entry.second.extension) != formats.end())
+			path_content.push_back(entry.second);
+	}
+}
+
 /*Sets new path.*/
 void Filesystem::newPath(const std::string& newPath_) {
 	if (path != newPath_) {
@@ -85,8 +232,16 @@ void Filesystem::newPath(const std::string& newPath_) {
 	}
 }
 
-/*Getter.*/
+/*Getters.*/
 const std::string& Filesystem::getPath(void) { return path; }
+bool Filesystem::isListing(void) const { return listing; }
+size_t Filesystem::listed(void) const { return entries.size(); }
+
+/*Amount of ids given in current listing. Every id is lower than this.*/
+unsigned int Filesystem::ids(void) const { return nextId; }
+
+/*Changes every time directory is walked again, which gives new ids.*/
+unsigned int Filesystem::getGeneration(void) const { return generation; }
 
 /*Moves path to the previous directory (closer to C:\).*/
 void Filesystem::back() {
@@ -95,6 +250,11 @@ void Filesystem::back() {
 	mustUpdate = true;
 }
 
+/*Filesystem destructor. Stops lister thread.*/
+Filesystem::~Filesystem() {
+	stopListing();
+}
+
 /*Static methods.*/
 /********************************************************/
 /*Checks if a path is a file.*/
@@ -112,4 +272,4 @@ const std::string Filesystem::originalPath(void) {
 	return boost::filesystem::current_path().string();
 };
 
-/********************************************************/
\ No newline at end of file
+/********************************************************/
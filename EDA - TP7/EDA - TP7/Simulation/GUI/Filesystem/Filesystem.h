@@ -1,16 +1,43 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <map>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include "DirWatcher.h"
 
 using strVec = std::vector<std::string>;
-using variadicArgs = std::initializer_list<const char*>;
+using variadicArgs = strVec;
+
+/*Directory entry. Its type, size and modification time
+are read once, when the directory is listed. Its id is unique
+and stable during a listing, so it can index per entry data.*/
+struct FileEntry {
+	std::string name, fullPath, extension;
+	unsigned int id;
+	bool isDir;
+	uintmax_t size;
+	std::time_t mtime;
+};
+using entryVec = std::vector<FileEntry>;
 
 class Filesystem {
 public:
 
 	Filesystem();
+	~Filesystem();
+
+	const entryVec& pathContent(const char* = nullptr, bool = false, const variadicArgs & = {});
 
-	const strVec& pathContent(const char* = nullptr, bool = false, const variadicArgs & = {});
+	bool update(void);
+	bool isListing(void) const;
+	size_t listed(void) const;
+	unsigned int ids(void) const;
+	unsigned int getGeneration(void) const;
 
 	void back();
 
@@ -23,9 +50,31 @@ public:
 	static bool isFile(const char*);
 	static const std::string originalPath(void);
 private:
+	void scan(const std::string&);
+	void list(const std::string&);
+	void stopListing(void);
+	void load(const std::string&);
+	void filter(const variadicArgs&);
+
+	/*Prevents from using copy constructor.*/
+	Filesystem(const Filesystem&);
 
 	/*Data members.*/
 	bool mustUpdate;
 	std::string path;
-	strVec path_content;
+	strVec formats;
+	std::map<std::string, FileEntry> entries;
+	entryVec path_content;
+	DirWatcher watcher;
+
+	/*Background listing. Lister thread publishes entries to 'found' in
+	batches, which the GUI thread merges into 'entries'. Removed entries
+	are kept in 'removed', so batches published later don't restore them.*/
+	std::thread lister;
+	std::atomic<bool> listing, cancelled;
+	std::atomic<unsigned int> nextId;
+	unsigned int generation;
+	std::mutex mtx;
+	entryVec found;
+	std::set<std::string> removed;
 };
@@ -2,10 +2,15 @@
 #include "imgui/imgui_impl_allegro5.h"
 #include "imgui/imgui_stdlib.h"
 #include "GUI.h"
+#include "../QuadTree/Codec/Codec.h"
 #include <allegro5/keyboard.h>
 #include <allegro5/mouse.h>
 #include <allegro5/allegro_primitives.h>
+#include <chrono>
 #include <functional>
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
 
 /*GUI data.*/
 /***************************************/
@@ -16,25 +21,94 @@ namespace data {
 	const float minThreshold = 0.1;
 	const float maxThreshold = 1;
 
-	const char* fixedFormat = ".png";
+	/*Initial size cap, in KB, and minimum PSNR, in dB, for targeted compression.*/
+	const float defaultMaxKB = 100;
+	const float defaultMinPSNR = 35;
+	const double bytesPerKB = 1024;
+	const char* targetNames[] = { "Threshold", "Max size (KB)", "Min PSNR (dB)" };
+	const char* criterionNames[] = { "Range", "Variance" };
+
+	const char* defaultImageFormat = ".png";
+
+	/*Frames drawn after each event, so ImGui can settle its layout and hover state.*/
+	const unsigned int settleFrames = 3;
+
+	/*Seconds between redraws while a batch is running.*/
+	const double progressRefresh = 1.0 / 30;
+
+	/*Seconds between checks for changes in current directory.*/
+	const double watchRefresh = 0.5;
+
+	/*Height of the file list and of the per file batch status list.
+	Threshold preview is a square as high as the file list.*/
+	const float filesHeight = 200;
+	const float previewSize = filesHeight;
+	const float statusHeight = 120;
+
+	/*Performance overlay's distance to the display's corner and background opacity.
+	Each frame's times weigh 'smoothing' in the shown ones.*/
+	const float overlayMargin = 10;
+	const float overlayAlpha = 0.7f;
+	const double smoothing = 0.1;
+	const float stageBarWidth = 160;
+
+	/*Initial size of the viewer window, and zoom factor of each mouse wheel step.*/
+	const float viewerSize = 520;
+	const double wheelZoom = 1.25;
+
+	/*Text and color of each batch file state.*/
+	const char* stateNames[] = { "pending", "running", "done", "failed", "cancelled" };
+	const ImVec4 stateColors[] = { ImVec4(0.6f, 0.6f, 0.6f, 1), ImVec4(1, 1, 0.4f, 1),
+		ImVec4(0.4f, 1, 0.4f, 1), ImVec4(1, 0.4f, 0.4f, 1), ImVec4(1, 0.7f, 0.3f, 1) };
 }
 /***************************************/
 
+/*Returns every image format with a registered codec, with initial '.'.*/
+static const strVec imageFormats(void) {
+	strVec result;
+	for (const auto& format : Codec::formats())
+		result.push_back('.' + format);
+	return result;
+}
+
 /*GUI constructor. Clears 'format' string and sets Allegro resources.*/
 GUI::GUI(void) :
 	threshold(data::minThreshold),
+	maxKB(data::defaultMaxKB),
+	minPSNR(data::defaultMinPSNR),
+	targetMode(TargetMode::THRESHOLD),
+	criterion(SplitCriterion::RANGE),
+	pipelined(false),
+	tracing(false),
+	verifying(false),
+	overlay(false),
+	frameTime(0),
+	filesTime(0),
+	listTime(0),
+	listing(0),
 	guiDisp(nullptr),
 	guiQueue(nullptr),
+	refreshTimer(nullptr),
+	watchTimer(nullptr),
 	action(Events::COMPRESS),
-	force(true),
+	progress(nullptr),
 	deep(0),
+	pendingFrames(data::settleFrames),
+	generation(0),
+	preview(nullptr),
+	thumbnails(nullptr),
+	viewer(nullptr),
 	action_msg("compression."),
-	showingFormat(data::fixedFormat)
+	imageFormat(data::defaultImageFormat),
+	showingFormats(imageFormats())
 {
 	format.clear();
 
 	setAllegro();
 
+	preview = new Preview;
+	thumbnails = new Thumbnails;
+	viewer = new Viewer;
 	path = fs.getPath();
 }
 
@@ -60,11 +134,17 @@ void GUI::setAllegro() {
 	else if (!(guiDisp = al_create_display(data::width, data::height)))
 		throw std::exception("Failed to create display.");
 
+	else if (!(refreshTimer = al_create_timer(data::progressRefresh)) || !(watchTimer = al_create_timer(data::watchRefresh)))
+		throw std::exception("Failed to create timer.");
+
 	else {
 		/*Attaches events to event queue.*/
 		al_register_event_source(guiQueue, al_get_keyboard_event_source());
 		al_register_event_source(guiQueue, al_get_mouse_event_source());
 		al_register_event_source(guiQueue, al_get_display_event_source(guiDisp));
+		al_register_event_source(guiQueue, al_get_timer_event_source(refreshTimer));
+		al_register_event_source(guiQueue, al_get_timer_event_source(watchTimer));
+		al_start_timer(watchTimer);
 
 		initialImGuiSetup();
 	}
@@ -91,14 +171,39 @@ void GUI::initialImGuiSetup(void) const {
 }
 
 /*Checks if user pressed ESC or closed display.
-It also deals with display resizing.*/
+It also deals with display resizing. Blocks until there is
+an event, unless there are frames left to draw.*/
 bool GUI::eventManager(void) {
 	bool result = false;
 
+	/*Refresh timer only ticks while a batch is running, a directory is being
+	listed, or a preview, thumbnails or a viewed file are loading. Once they end,
+	a few last frames show their final state.*/
+	if ((progress && progress->isRunning()) || fs.isListing() || preview->isLoading() || thumbnails->isBusy() || viewer->isLoading()) {
+		if (!al_get_timer_started(refreshTimer))
+			al_start_timer(refreshTimer);
+	}
+	else if (al_get_timer_started(refreshTimer)) {
+		al_stop_timer(refreshTimer);
+		pendingFrames = data::settleFrames;
+	}
+
+	if (!pendingFrames)
+		al_wait_for_event(guiQueue, nullptr);
+
 	//Gets events.
 	while ((al_get_next_event(guiQueue, &guiEvent)))
 	{
+		/*Progress ticks only need a redraw. Watch ticks
+		need one only if current directory changed.*/
+		if (guiEvent.type == ALLEGRO_EVENT_TIMER) {
+			if (guiEvent.timer.source == refreshTimer || fs.update())
+				pendingFrames = std::max(pendingFrames, 1u);
+			continue;
+		}
+
 		ImGui_ImplAllegro5_ProcessEvent(&guiEvent);
+		pendingFrames = data::settleFrames;
 
 		/*If the display has been closed or if the user has pressed ESC, return true. */
 		if (guiEvent.type == ALLEGRO_EVENT_DISPLAY_CLOSE || (guiEvent.type == ALLEGRO_EVENT_KEY_DOWN &&
@@ -117,8 +222,9 @@ bool GUI::eventManager(void) {
 }
 
 //Cycle that shows menu (called with every iteration).
+//Only draws when there was input, a resize or batch progress.
 const Events GUI::checkStatus(void) {
-	Events result;
+	Events result = Events::NOTHING;
 
 	al_set_target_backbuffer(guiDisp);
 
@@ -126,7 +232,10 @@ const Events GUI::checkStatus(void) {
 	if (eventManager())
 		result = Events::END;
 
-	else {
+	else if (pendingFrames) {
+		const auto frameStart = std::chrono::steady_clock::now();
+		pendingFrames--;
+
 		/*Sets new ImGui window.*/
 		newWindow();
 
@@ -145,15 +254,31 @@ const Events GUI::checkStatus(void) {
 
 		ImGui::NewLine(); ImGui::NewLine();
 
-		/*Slider for threshold.*/
-		ImGui::Text("Compression threshold: ");
+		/*What compression aims at, and slider for threshold or its target value.*/
+		displayTarget();
+
+		/*Checkbox for pipelined compression.*/
 		ImGui::SameLine();
-		ImGui::SliderFloat("-", &threshold, data::minThreshold, data::maxThreshold);
+		ImGui::Checkbox("Pipelined", &pipelined);
+
+		/*Checkbox for batch tracing.*/
+		ImGui::SameLine();
+		ImGui::Checkbox("Trace", &tracing);
+
+		/*Checkbox for round trip verification of compressed files.*/
+		ImGui::SameLine();
+		ImGui::Checkbox("Verify", &verifying);
+
+		/*Checkbox for performance overlay.*/
+		ImGui::SameLine();
+		ImGui::Checkbox("Overlay", &overlay);
 
 		ImGui::NewLine(); ImGui::NewLine();
 
 		/*Files from path.*/
+		const auto filesStart = std::chrono::steady_clock::now();
 		displayFiles();
+		const double files = std::chrono::duration<double>(std::chrono::steady_clock::now() - filesStart).count();
 
 		ImGui::NewLine();
 
@@ -167,13 +292,33 @@ const Events GUI::checkStatus(void) {
 
 		ImGui::SameLine();
 
-		/*Perform button.*/
-		displayWidget("Perform", [this, &result]() {result = action; });
+		/*Perform button. Becomes a cancel button while a batch runs.*/
+		if (progress && progress->isRunning())
+			displayWidget("Cancel", [this]() {progress->cancel(); });
+		else
+			displayWidget("Perform", [this, &result]() {result = action; });
+
+		/*Running or last batch.*/
+		displayProgress();
 
 		ImGui::End();
 
+		/*Compressed file viewer, in its own window.*/
+		displayViewer();
+
+		/*Frame times of the previous frame, over the rest of windows.*/
+		displayOverlay();
+
 		/*Rendering.*/
 		render();
+
+		/*Smooths times measured in this frame into the shown ones.
+		Directory scanning is timed by updateFiles.*/
+		const double frame = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+		frameTime += (frame - frameTime) * data::smoothing;
+		filesTime += (files - filesTime) * data::smoothing;
+		listTime += (listing - listTime) * data::smoothing;
+		listing = 0;
 	}
 	return result;
 }
@@ -183,39 +328,87 @@ inline void GUI::displayActions() {
 	ImGui::Text("Action to perform: ");
 
 	/*Button callback for both buttons.*/
-	const auto button_callback = [this](const Events code, const char* msg, const std::string& newFormat) {
+	const auto button_callback = [this](const Events code, const char* msg, const strVec& newFormats) {
 		action = code;
 		action_msg = msg;
-		files.clear();
-		force = true;
-		showingFormat = newFormat;
+		selection.clear();
+		showingFormats = newFormats;
 	};
 
 	/*Compress button.*/
-	displayWidget("Compress", std::bind(button_callback, Events::COMPRESS, "compression.", data::fixedFormat));
+	displayWidget("Compress", std::bind(button_callback, Events::COMPRESS, "compression.", imageFormats()));
 	ImGui::SameLine();
 
 	/*Decompress button.*/
-	displayWidget("Decompress", std::bind(button_callback, Events::DECOMPRESS, "decompression.", format));
+	displayWidget("Decompress", std::bind(button_callback, Events::DECOMPRESS, "decompression.", strVec({ format })));
 	ImGui::SameLine();
 
 	/*Message with selected option.*/
 	ImGui::Text(("Selected: " + action_msg).c_str());
 }
 
-/*Displays text input for file format.*/
+/*Displays radio buttons for compression target and a slider for threshold or an
+input for size cap or minimum PSNR. Other targets search the threshold per file.
+Below them, radio buttons for the split criterion.*/
+inline void GUI::displayTarget() {
+	ImGui::Text("Compression target:    ");
+
+	for (int i = 0; i < 3; i++) {
+		ImGui::SameLine();
+		displayWidget([this, i]() {return ImGui::RadioButton(data::targetNames[i], (int)targetMode == i); },
+			[this, i]() {targetMode = (TargetMode)i; });
+	}
+
+	switch (targetMode) {
+	case TargetMode::SIZE:
+		ImGui::Text("Largest output size:   ");
+		ImGui::SameLine();
+		ImGui::InputFloat("KB", &maxKB, 1, 10, "%.1f");
+		maxKB = std::max(maxKB, 0.f);
+		break;
+	case TargetMode::PSNR:
+		ImGui::Text("Lowest PSNR:           ");
+		ImGui::SameLine();
+		ImGui::InputFloat("dB", &minPSNR, 0.5f, 5, "%.1f");
+		break;
+	default:
+		ImGui::Text("Compression threshold: ");
+		ImGui::SameLine();
+		ImGui::SliderFloat("-", &threshold, data::minThreshold, data::maxThreshold);
+		break;
+	}
+
+	ImGui::Text("Split criterion:       ");
+	for (int i = 0; i < 2; i++) {
+		ImGui::SameLine();
+		displayWidget([this, i]() {return ImGui::RadioButton(data::criterionNames[i], (int)criterion == i); },
+			[this, i]() {criterion = (SplitCriterion)i; });
+	}
+}
+
+/*Displays text input for file format and radio buttons for decompressed image format.*/
 inline Events GUI::displayFormat() {
+	Events result = Events::NOTHING;
+
 	ImGui::Text("Compression format:    ");
 	ImGui::SameLine();
 	if (ImGui::InputText(" ~ ", &format, ImGuiInputTextFlags_CharsNoBlank) && format.length()) {
 		format = '.' + format.substr(format.find_last_of('.') + 1, format.length());
-		force = true;
 		if (action == Events::DECOMPRESS)
-			showingFormat = format;
-		return Events::FORMAT;
+			showingFormats = { format };
+		result = Events::FORMAT;
 	}
 
-	return Events::NOTHING;
+	ImGui::Text("Decompressed format:   ");
+
+	/*One radio button for each available codec.*/
+	for (const auto& imgFormat : imageFormats()) {
+		ImGui::SameLine();
+		displayWidget([this, &imgFormat]() {return ImGui::RadioButton(imgFormat.c_str(), imageFormat == imgFormat); },
+			[this, &imgFormat, &result]() {imageFormat = imgFormat; result = Events::FORMAT; });
+	}
+
+	return result;
 }
 
 /*Displays text input for path.*/
@@ -242,46 +435,261 @@ void GUI::displayFiles() {
 	ImGui::TextWrapped(tempPath.c_str());
 
 	ImGui::NewLine();
-	ImGui::Text(("Showing format: " + showingFormat).c_str());
+	std::string showing;
+	for (const auto& showingFormat : showingFormats)
+		showing += showingFormat + ' ';
+	ImGui::Text(("Showing format: " + showing).c_str());
 
 	/*'Select all' button.*/
-	displayWidget("Select All", [this]() {for (auto& file : files)file.second = action; });
+	displayWidget("Select All", [this]() {
+		for (const auto& entry : updateFiles())
+			if (!entry.isDir && format.length()) selected(entry) = action; });
 
 	ImGui::SameLine();
 
 	/*'Deselect all' button.*/
-	displayWidget("Deselect all", [this]() {for (auto& file : files) file.second = Events::NOTHING; });
+	displayWidget("Deselect all", [this]() {selection.assign(selection.size(), Events::NOTHING); });
+
+	/*Entries found so far, while current directory is still being listed.*/
+	if (fs.isListing()) {
+		ImGui::SameLine();
+		ImGui::Text("Listing... %u entries found.", (unsigned int)fs.listed());
+	}
 
 	//ImGui::NewLine();
 	ImGui::Text("-----------------------------------");
-	/*Loops through every file in files map.*/
-	for (const auto& file : updateFiles()) {
-		/*If it's a directory...*/
-		if (Filesystem::isDir((tempPath + '\\' + file).c_str())) {
-			/*Sets a button with its name. If pressed, it updates path,
-			clears files map for new files and increases depth flag.*/
-			displayWidget(file.c_str(),
-
-				[this, &file, &tempPath]() {
-					fs.newPath(tempPath + '\\' + file);
-					files.clear();
-					deep++;
-					path = tempPath + '\\' + file;
-				});
+	/*Shows thumbnails generated since last frame.*/
+	thumbnails->update();
+
+	/*Loops through every cached entry in path. Only visible rows are built.*/
+	const entryVec& content = updateFiles();
+	const ImVec2 thumbSize((float)thumbnails->getSide(), (float)thumbnails->getSide());
+	const bool previewing = action == Events::COMPRESS;
+	ImGui::BeginChild("Files", ImVec2(previewing ? -(data::previewSize + ImGui::GetStyle().ItemSpacing.x) : 0, data::filesHeight));
+	ImGuiListClipper clipper(content.size());
+	while (clipper.Step()) {
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+			const FileEntry& entry = content[i];
+			ImGui::PushID(i);
+
+			/*Thumbnail, or empty space while it's not ready.*/
+			ALLEGRO_BITMAP* thumb = entry.isDir ? nullptr : thumbnails->get(entry, entry.extension == format);
+			if (thumb)
+				ImGui::Image((ImTextureID)thumb, thumbSize);
+			else
+				ImGui::Dummy(thumbSize);
+			ImGui::SameLine();
+
+			/*If it's a directory...*/
+			if (entry.isDir) {
+				/*Sets a button with its name. If pressed, it updates path
+				and increases depth flag. Selection is cleared with new listing.*/
+				displayWidget(entry.name.c_str(),
+
+					[this, &entry]() {
+						path = entry.fullPath;
+						fs.newPath(path);
+						deep++;
+					});
+			}
+
+			/*If it's a file...*/
+			else {
+				Events& checker = selected(entry);
+				bool checked = checker != Events::NOTHING;
+
+				/*Sets a checkbox with its name. Updates file's selection.
+				Images checked for compression are previewed.*/
+				displayWidget(std::bind(ImGui::Checkbox, entry.name.c_str(), &checked),
+					[&checker, &checked, &entry, this]() {
+						if (checked && format.length()) checker = action;
+						else checker = Events::NOTHING;
+						if (checked && action == Events::COMPRESS) preview->load(entry.fullPath); });
+
+				/*Compressed files can be opened in the viewer.*/
+				if (entry.extension == format) {
+					ImGui::SameLine();
+					displayWidget([]() {return ImGui::SmallButton("View"); }, [this, &entry]() {viewer->open(entry.fullPath); });
+				}
+			}
+			ImGui::PopID();
 		}
+	}
+	ImGui::EndChild();
+
+	/*Preview of last checked image, next to the list.*/
+	if (previewing) {
+		ImGui::SameLine();
+		displayPreview();
+	}
+	ImGui::Text("-----------------------------------");
+}
+
+/*Displays last checked image as it would be compressed at current threshold,
+with its estimated compressed size and PSNR.*/
+void GUI::displayPreview() {
+	preview->update(threshold, criterion);
+
+	ImGui::BeginGroup();
+	if (preview->getBitmap()) {
+		const Estimate& estimate = preview->getEstimate();
+		ImGui::Image((ImTextureID)preview->getBitmap(), ImVec2(data::previewSize, data::previewSize));
+		ImGui::Text(preview->isExact() ? "~%.1f KB, %.1f dB" : "~%.1f KB, ~%.1f dB", estimate.bytes / data::bytesPerKB, estimate.psnr);
+	}
+	else if (preview->isLoading())
+		ImGui::Text("Loading preview...");
+	else if (preview->getError().length())
+		ImGui::TextWrapped("%s", preview->getError().c_str());
+	else
+		ImGui::TextWrapped("Check an image to preview it.");
+	ImGui::EndGroup();
+}
+
+/*Displays open compressed file. Mouse wheel zooms around the cursor
+and dragging pans. Only the visible region is decompressed.*/
+void GUI::displayViewer() {
+	if (!viewer->isOpen())
+		return;
+
+	bool open = true;
+	ImGui::SetNextWindowSize(ImVec2(data::viewerSize, data::viewerSize), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin("Viewer", &open)) {
+		ImGui::End();
+		if (!open)
+			viewer->close();
+		return;
+	}
+
+	displayWidget("Fit", [this]() {viewer->fit(); });
+	ImGui::SameLine();
+	if (viewer->getSide())
+		ImGui::Text("%ux%u  zoom %.0f%%", viewer->getSide(), viewer->getSide(), viewer->getScale() * 100);
+	ImGui::TextWrapped("%s", viewer->getPath().c_str());
+
+	/*View fills the rest of the window.*/
+	const ImVec2 size = ImGui::GetContentRegionAvail();
+	const ImVec2 origin = ImGui::GetCursorScreenPos();
+	if (size.x >= 1 && size.y >= 1) {
+		ImGui::InvisibleButton("View", size);
+
+		const ImGuiIO& io = ImGui::GetIO();
+		if (ImGui::IsItemActive() && ImGui::IsMouseDragging(0, 0))
+			viewer->pan(io.MouseDelta.x, io.MouseDelta.y);
+		if (ImGui::IsItemHovered() && io.MouseWheel)
+			viewer->zoom(std::pow(data::wheelZoom, io.MouseWheel), io.MousePos.x - origin.x, io.MousePos.y - origin.y);
+
+		viewer->update((unsigned int)size.x, (unsigned int)size.y);
+		if (viewer->getBitmap())
+			ImGui::GetWindowDrawList()->AddImage((ImTextureID)viewer->getBitmap(), origin, ImVec2(origin.x + (unsigned int)size.x, origin.y + (unsigned int)size.y));
+		else if (viewer->isLoading())
+			ImGui::GetWindowDrawList()->AddText(origin, ImGui::GetColorU32(ImGuiCol_Text), "Loading...");
+		else if (viewer->getError().length())
+			ImGui::GetWindowDrawList()->AddText(origin, ImGui::GetColorU32(ImGuiCol_Text), viewer->getError().c_str());
+	}
+	ImGui::End();
+
+	if (!open)
+		viewer->close();
+}
+
+/*Displays batch progress bar, throughput and every file's state.*/
+void GUI::displayProgress() {
+	if (!progress || !progress->getTotal())
+		return;
 
-		/*If it's a file...*/
-		else if (Filesystem::isFile((tempPath + '\\' + file).c_str())) {
-			Events& checker = files[tempPath + '\\' + file];
+	const unsigned int total = progress->getTotal();
+	const unsigned int finished = progress->getDone() + progress->getFailed();
+	char stats[128];
 
-			/*Sets a checkbox with its name. Updates file's value in map.*/
-			displayWidget(std::bind(ImGui::Checkbox, file.c_str(), (bool*)&checker),
-				[&checker, this]() {
-					if ((bool)checker && format.length()) checker = action;
-					else checker = Events::NOTHING; });
+	ImGui::NewLine();
+	ImGui::ProgressBar((float)finished / total);
+
+	snprintf(stats, sizeof(stats), "%u/%u done, %u failed. %.1f files/s, %.2f MB/s, %.1f s%s",
+		progress->getDone(), total, progress->getFailed(), progress->getFilesPerSecond(),
+		progress->getMBPerSecond(), progress->getElapsed(), progress->isCancelled() ? " (cancelled)" : "");
+	ImGui::TextUnformatted(stats);
+
+	/*Quality of files compressed so far.*/
+	const CodecStats totals = progress->getStats();
+	if (totals.samples)
+		displayQuality(totals);
+
+	/*Per file states. Only visible rows are drawn.*/
+	ImGui::BeginChild("Batch", ImVec2(0, data::statusHeight), true);
+	ImGuiListClipper clipper(total);
+	while (clipper.Step()) {
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+			const FileState state = progress->getState(i);
+
+			ImGui::TextColored(data::stateColors[(int)state], "%-10s", data::stateNames[(int)state]);
+			ImGui::SameLine();
+			if (state == FileState::FAILED)
+				ImGui::Text("%s: %s", progress->getName(i).c_str(), progress->getMessage(i).c_str());
+			else
+				ImGui::TextUnformatted(progress->getName(i).c_str());
 		}
 	}
-	ImGui::Text("-----------------------------------");
+	ImGui::EndChild();
+}
+
+/*Displays frame time, and the share of it spent listing files and scanning
+the directory, over the display's top right corner. While there is a batch,
+it also shows its throughput and where its last file's time went.*/
+void GUI::displayOverlay() {
+	if (!overlay)
+		return;
+
+	const ImVec2 corner(ImGui::GetIO().DisplaySize.x - data::overlayMargin, data::overlayMargin);
+	ImGui::SetNextWindowPos(corner, ImGuiCond_Always, ImVec2(1, 0));
+	ImGui::SetNextWindowBgAlpha(data::overlayAlpha);
+	ImGui::Begin("Overlay", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings
+		| ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
+
+	const double share = frameTime > 0 ? 100 / frameTime : 0;
+	ImGui::Text("Frame:     %6.2f ms", frameTime * 1000);
+	ImGui::Text("File list: %6.2f ms (%4.1f%%)", filesTime * 1000, filesTime * share);
+	ImGui::Text("Dir scan:  %6.2f ms (%4.1f%%)", listTime * 1000, listTime * share);
+
+	if (progress && progress->getTotal()) {
+		ImGui::Separator();
+		ImGui::Text("Batch: %.1f files/s, %.2f MB/s", progress->getFilesPerSecond(), progress->getMBPerSecond());
+
+		const CodecStats last = progress->getLastStats();
+		if (last.calls) {
+			ImGui::Text("Last file:");
+			displayStages(last);
+		}
+	}
+	ImGui::End();
+}
+
+/*Displays each stage's time in 'stats' as a bar with its share of their sum.*/
+void GUI::displayStages(const CodecStats& stats) {
+	const char* names[] = { "Decode", "Build", "Encode" };
+	const double times[] = { stats.decodeTime, stats.buildTime, stats.encodeTime };
+	const double total = times[0] + times[1] + times[2];
+	char label[32];
+
+	for (unsigned int i = 0; i < 3; i++) {
+		const float share = total > 0 ? (float)(times[i] / total) : 0;
+		snprintf(label, sizeof(label), "%.2f ms", times[i] * 1000);
+		ImGui::Text("%-7s", names[i]);
+		ImGui::SameLine();
+		ImGui::ProgressBar(share, ImVec2(data::stageBarWidth, 0), label);
+		ImGui::SameLine();
+		ImGui::Text("%3.0f%%", share * 100);
+	}
+	ImGui::Text("%llu nodes, %llu leaves, depth %u", stats.nodes, stats.leaves, stats.maxDepth);
+	if (stats.samples)
+		displayQuality(stats);
+}
+
+/*Displays PSNR of compressed files in 'stats', and their SSIM if they were verified.*/
+void GUI::displayQuality(const CodecStats& stats) {
+	if (stats.verified)
+		ImGui::Text("PSNR %.2f dB, SSIM %.4f", stats.getPSNR(), stats.getSSIM());
+	else
+		ImGui::Text("PSNR %.2f dB", stats.getPSNR());
 }
 
 /*Sets a new ImGUI frame and window.*/
@@ -309,15 +717,55 @@ inline void GUI::render() const {
 
 /*Getters.*/
 const std::string& GUI::getFormat(void) const { return format; }
+const std::string& GUI::getImageFormat(void) const { return imageFormat; }
 const float GUI::getThreshold(void) const { return threshold; }
-const std::map<std::string, Events>& GUI::getFiles(void) const { return files; }
+TargetMode GUI::getTargetMode(void) const { return targetMode; }
+bool GUI::isPipelined(void) const { return pipelined; }
+bool GUI::isTracing(void) const { return tracing; }
+bool GUI::isVerifying(void) const { return verifying; }
+SplitCriterion GUI::getCriterion(void) const { return criterion; }
+
+/*Returns value of current target: threshold, size cap in bytes or minimum PSNR in dB.*/
+double GUI::getTarget(void) const {
+	switch (targetMode) {
+	case TargetMode::SIZE:
+		return maxKB * data::bytesPerKB;
+	case TargetMode::PSNR:
+		return minPSNR;
+	default:
+		return threshold;
+	}
+}
+
+/*Setter. GUI shows and can cancel the given batch progress.*/
+void GUI::setProgress(Progress* progress) { this->progress = progress; }
+
+/*Returns full path of every listed file marked with 'ev'.*/
+const strVec GUI::getFiles(const Events& ev) {
+	strVec result;
+	for (const auto& entry : updateFiles()) {
+		if (!entry.isDir && selected(entry) == ev)
+			result.push_back(entry.fullPath);
+	}
+	return result;
+}
 
 /*Cleanup. Frees resources.*/
 GUI::~GUI() {
+	if (preview)
+		delete preview;
+	if (thumbnails)
+		delete thumbnails;
+	if (viewer)
+		delete viewer;
 	ImGui_ImplAllegro5_Shutdown();
 	ImGui::DestroyContext();
 	if (guiQueue)
 		al_destroy_event_queue(guiQueue);
+	if (refreshTimer)
+		al_destroy_timer(refreshTimer);
+	if (watchTimer)
+		al_destroy_timer(watchTimer);
 	if (guiDisp)
 		al_destroy_display(guiDisp);
 }
@@ -341,12 +789,25 @@ inline auto GUI::displayWidget(const char* txt, const F1& f1, const F2& f2)->dec
 	return f2();
 }
 
-/*Binding fs.pathContent with this->force and specified file format.
-Helps to determine when to update file info.*/
-const std::vector<std::string>& GUI::updateFiles(const char* path) {
-	bool shouldForce = force;
+/*Returns selection of given entry. Selection is indexed by entry id,
+and cleared when directory is listed again, as ids start over.*/
+Events& GUI::selected(const FileEntry& entry) {
+	if (generation != fs.getGeneration()) {
+		generation = fs.getGeneration();
+		selection.clear();
+	}
+	if (selection.size() < fs.ids())
+		selection.resize(fs.ids(), Events::NOTHING);
 
-	if (force) { force = !force; }
+	return selection[entry.id];
+}
 
-	return fs.pathContent(path, shouldForce, { showingFormat.c_str() });
+/*Binding fs.pathContent with specified file format. Format
+changes only filter the cached listing, they don't reload it.
+Time spent is added to this frame's directory scanning time.*/
+const entryVec& GUI::updateFiles(const char* path) {
+	const auto start = std::chrono::steady_clock::now();
+	const entryVec& content = fs.pathContent(path, false, showingFormats);
+	listing += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return content;
 }
\ No newline at end of file
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <allegro5/allegro.h>
-#include <map>
 #include "Filesystem/Filesystem.h"
+#include "../QuadTree/QuadTree.h"
+#include "../Progress/Progress.h"
+#include "Preview/Preview.h"
+#include "Thumbnails/Thumbnails.h"
+#include "Viewer/Viewer.h"
 
 /*GUI event codes.*/
 /********************************/
@@ -25,9 +29,18 @@ public:
 	const Events checkStatus(void);
 
 	const std::string& getFormat() const;
+	const std::string& getImageFormat() const;
 	const float getThreshold() const;
+	TargetMode getTargetMode() const;
+	double getTarget() const;
+	SplitCriterion getCriterion() const;
+	bool isPipelined() const;
+	bool isTracing() const;
+	bool isVerifying() const;
 
-	const std::map<std::string, Events>& getFiles(void) const;
+	void setProgress(Progress*);
+
+	const strVec getFiles(const Events&);
 private:
 
 	/*Initial setup.*/
@@ -42,7 +55,14 @@ private:
 	inline void displayPath();
 	inline Events displayFormat();
 	inline void displayActions();
+	inline void displayTarget();
 	void displayFiles();
+	void displayProgress();
+	void displayPreview();
+	void displayViewer();
+	void displayOverlay();
+	void displayStages(const CodecStats&);
+	void displayQuality(const CodecStats&);
 
 	template <class Widget, class F1, class F2 = void(*)(void)>
 	inline auto displayWidget(const Widget&, const F1& f1, const F2 & = []() {}) -> decltype(f1());
@@ -60,27 +80,44 @@ private:
 	/******************************/
 	ALLEGRO_DISPLAY* guiDisp;
 	ALLEGRO_EVENT_QUEUE* guiQueue;
+	ALLEGRO_TIMER* refreshTimer;
+	ALLEGRO_TIMER* watchTimer;
 	ALLEGRO_EVENT guiEvent;
 	/******************************/
 
 	/*Flag data members.*/
 	/******************************/
-	bool force;
 	int deep;
+	unsigned int pendingFrames;
 	std::string action_msg;
 	Events action;
+	Progress* progress;
+	/******************************/
+
+	/*Performance overlay. Times are smoothed over the last frames, in seconds.*/
+	/******************************/
+	double frameTime, filesTime, listTime, listing;
 	/******************************/
 
 	/*Data members modifiable by user.*/
 	/**********************************/
-	float threshold;
-	std::string format, path, showingFormat;
+	float threshold, maxKB, minPSNR;
+	TargetMode targetMode;
+	SplitCriterion criterion;
+	bool pipelined, tracing, verifying, overlay;
+	std::string format, imageFormat, path;
+	strVec showingFormats;
 	/**********************************/
 
 	/*File handling.*/
 	/*************************************************************/
 	Filesystem fs;
-	std::map <std::string, Events> files;
-	const std::vector<std::string>& updateFiles(const char* = nullptr);
+	Preview* preview;
+	Thumbnails* thumbnails;
+	Viewer* viewer;
+	std::vector<Events> selection;
+	unsigned int generation;
+	const entryVec& updateFiles(const char* = nullptr);
+	Events& selected(const FileEntry&);
 	/*************************************************************/
 };
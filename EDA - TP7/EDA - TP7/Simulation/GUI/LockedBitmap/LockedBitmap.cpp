@@ -0,0 +1,50 @@
+#include "LockedBitmap.h"
+
+/*Channel layouts of 32 bit Allegro formats, as bytes in memory. Allegro
+formats name channels from most to least significant bit, so on little
+endian machines bytes are in reverse order. Formats without alpha
+ignore the alpha byte.*/
+/********************************************/
+namespace {
+	struct NativeFormat {
+		int format;
+		PixelLayout layout;
+	};
+
+	const NativeFormat nativeFormats[] = {
+		{ ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, { 0, 1, 2, 3 } },
+		{ ALLEGRO_PIXEL_FORMAT_ABGR_8888, { 0, 1, 2, 3 } },
+		{ ALLEGRO_PIXEL_FORMAT_XBGR_8888, { 0, 1, 2, 3 } },
+		{ ALLEGRO_PIXEL_FORMAT_ARGB_8888, { 2, 1, 0, 3 } },
+		{ ALLEGRO_PIXEL_FORMAT_XRGB_8888, { 2, 1, 0, 3 } },
+		{ ALLEGRO_PIXEL_FORMAT_RGBA_8888, { 3, 2, 1, 0 } },
+		{ ALLEGRO_PIXEL_FORMAT_RGBX_8888, { 3, 2, 1, 0 } }
+	};
+}
+/********************************************/
+
+/*LockedBitmap constructor. Locks whole bitmap. If it can't be
+locked, getData() returns nullptr.*/
+LockedBitmap::LockedBitmap(ALLEGRO_BITMAP* bitmap) : bitmap(bitmap), region(nullptr), layout(rgbaLayout) {
+	const int format = al_get_bitmap_format(bitmap);
+
+	for (const auto& native : nativeFormats) {
+		if (native.format == format) {
+			layout = native.layout;
+			region = al_lock_bitmap(bitmap, format, ALLEGRO_LOCK_WRITEONLY);
+			return;
+		}
+	}
+	region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+}
+
+/*Getters.*/
+unsigned char* LockedBitmap::getData(void) const { return region ? (unsigned char*)region->data : nullptr; }
+int LockedBitmap::getPitch(void) const { return region ? region->pitch : 0; }
+const PixelLayout& LockedBitmap::getLayout(void) const { return layout; }
+
+/*LockedBitmap destructor. Unlocks bitmap, uploading written pixels.*/
+LockedBitmap::~LockedBitmap() {
+	if (region)
+		al_unlock_bitmap(bitmap);
+}
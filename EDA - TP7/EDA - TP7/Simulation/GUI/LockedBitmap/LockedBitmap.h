@@ -0,0 +1,28 @@
+#pragma once
+#include <allegro5/allegro.h>
+#include "../../QuadTree/PixelSink/PixelSink.h"
+
+/*Locks a bitmap for writing for as long as it lives. If bitmap has a 32 bit
+format, it's locked in that format, so pixels written to it go straight to
+the bitmap without conversion. Otherwise, it's locked as RGBA and Allegro
+converts it on unlock.*/
+class LockedBitmap {
+public:
+	LockedBitmap(ALLEGRO_BITMAP*);
+	~LockedBitmap();
+
+	unsigned char* getData(void) const;
+	int getPitch(void) const;
+	const PixelLayout& getLayout(void) const;
+
+private:
+	/*Prevents from using copy constructor.*/
+	LockedBitmap(const LockedBitmap&);
+
+	/*Data members.*/
+	/***********************************************/
+	ALLEGRO_BITMAP* bitmap;
+	ALLEGRO_LOCKED_REGION* region;
+	PixelLayout layout;
+	/***********************************************/
+};
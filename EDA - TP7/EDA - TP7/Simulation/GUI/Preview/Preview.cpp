@@ -0,0 +1,140 @@
+#include "Preview.h"
+#include "../../QuadTree/QuadTree.h"
+#include "../LockedBitmap/LockedBitmap.h"
+#include <algorithm>
+#include <thread>
+
+namespace {
+	/*Side of rendered preview, in pixels. Smaller images are shown as they are.*/
+	const unsigned int previewSide = 256;
+
+	/*Levels of node statistics kept. Images up to 2^statsLevels pixels per side
+	keep all of them. Larger ones keep their top levels, about 20 MB, which is
+	more than previews need to render.*/
+	const unsigned int statsLevels = 10;
+}
+
+/*Preview constructor. Nothing is shown yet.*/
+Preview::Preview() : bitmap(nullptr), estimate(), shown(-1), side(0) {}
+
+/*Starts loading image at 'path' on a background thread.
+Previous image keeps being shown until it's ready.*/
+void Preview::load(const std::string& path) {
+	if (path == this->path)
+		return;
+
+	this->path = path;
+	error.clear();
+
+	/*A previous load stops at its next check. Loads run on detached threads that
+	own everything they use, so one that's busy decoding finishes on its own,
+	and neither a new load nor the destructor waits for it.*/
+	if (cancelled)
+		*cancelled = true;
+	cancelled = std::make_shared<std::atomic<bool>>(false);
+
+	const auto promise = std::make_shared<std::promise<Loaded>>();
+	pending = promise->get_future();
+	std::thread([path, promise](std::shared_ptr<std::atomic<bool>> cancelled) {
+		try {
+			Loaded result;
+			std::vector<unsigned char> data;
+
+			Codec::readFile(path, data);
+			if (*cancelled)
+				return;
+			result.stats.reset(new StatsPyramid);
+			QuadTree().buildStats(data, Codec::extension(path), *result.stats, statsLevels);
+			if (*cancelled)
+				return;
+			result.estimator.reset(new Estimator(result.stats->getPixels(), result.stats->getSide()));
+			promise->set_value(std::move(result));
+		}
+		catch (...) {
+			promise->set_exception(std::current_exception());
+		}
+		}, cancelled).detach();
+}
+
+/*Takes loaded image, if there is one, and renders and estimates it at the given
+threshold and criterion if either changed. Returns true if shown image changed.*/
+bool Preview::update(const double threshold, const SplitCriterion criterion) {
+	if (pending.valid() && pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		try {
+			Loaded loaded = pending.get();
+			estimator = std::move(loaded.estimator);
+			stats = std::move(loaded.stats);
+			side = std::min(stats->getSide(), previewSide);
+			shown = -1;
+		}
+		catch (std::exception& e) {
+			error = e.what();
+			estimator.reset();
+			stats.reset();
+		}
+	}
+
+	if (!stats)
+		return false;
+	if (criterion != stats->getCriterion()) {
+		stats->setCriterion(criterion);
+		estimator->setCriterion(criterion);
+		shown = -1;
+	}
+	if (threshold == shown || !draw(threshold))
+		return false;
+
+	/*Compressed size is always estimated. Images whose statistics were kept
+	down to single pixels get their node counts and PSNR from them, exactly.*/
+	try {
+		estimate = estimator->estimate(threshold);
+		if (stats->isComplete()) {
+			estimate.nodes = (double)stats->countNodes(threshold);
+			estimate.leaves = (3 * estimate.nodes + 1) / 4;
+			estimate.psnr = stats->getPSNR(threshold);
+		}
+	}
+	catch (std::exception& e) {
+		error = e.what();
+		estimator.reset();
+		stats.reset();
+		return false;
+	}
+	shown = threshold;
+	return true;
+}
+
+/*Renders preview straight into bitmap, creating it if its size changed.
+Returns false if bitmap couldn't be created or locked.*/
+bool Preview::draw(const double threshold) {
+	if (bitmap && (unsigned int)al_get_bitmap_width(bitmap) != side) {
+		al_destroy_bitmap(bitmap);
+		bitmap = nullptr;
+	}
+	if (!bitmap && !(bitmap = al_create_bitmap(side, side)))
+		return false;
+
+	LockedBitmap locked(bitmap);
+	if (!locked.getData())
+		return false;
+
+	stats->render(threshold, locked.getData(), side, locked.getPitch(), locked.getLayout());
+	return true;
+}
+
+/*Getters.*/
+ALLEGRO_BITMAP* Preview::getBitmap(void) const { return stats ? bitmap : nullptr; }
+const Estimate& Preview::getEstimate(void) const { return estimate; }
+bool Preview::isExact(void) const { return stats && stats->isComplete(); }
+bool Preview::isLoading(void) const { return pending.valid(); }
+const std::string& Preview::getPath(void) const { return path; }
+const std::string& Preview::getError(void) const { return error; }
+
+/*Preview destructor. Must be destroyed before display.
+Cancels a load still running, without waiting for it.*/
+Preview::~Preview() {
+	if (cancelled)
+		*cancelled = true;
+	if (bitmap)
+		al_destroy_bitmap(bitmap);
+}
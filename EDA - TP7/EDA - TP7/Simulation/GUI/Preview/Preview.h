@@ -0,0 +1,57 @@
+#pragma once
+#include <allegro5/allegro.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <future>
+#include <memory>
+#include "../../QuadTree/StatsPyramid/StatsPyramid.h"
+#include "../../QuadTree/Estimator/Estimator.h"
+
+/*Shows an image as it would look compressed at a given threshold and split
+criterion, and an estimate of its compressed size and PSNR. PSNR and node
+counts are exact for images whose statistics are kept whole. Image is decoded
+and its node statistics built on a background thread. Only the top levels of
+statistics of large images are kept, which is enough to render them. After
+that, a threshold or criterion change only re-decides splits, so it's cheap to
+do every frame.*/
+class Preview {
+public:
+	Preview();
+	~Preview();
+
+	void load(const std::string&);
+	bool update(const double, const SplitCriterion);
+
+	ALLEGRO_BITMAP* getBitmap(void) const;
+	const Estimate& getEstimate(void) const;
+	bool isExact(void) const;
+	bool isLoading(void) const;
+	const std::string& getPath(void) const;
+	const std::string& getError(void) const;
+
+private:
+	bool draw(const double);
+
+	/*Statistics of a loaded image, and its estimator.*/
+	struct Loaded {
+		std::unique_ptr<StatsPyramid> stats;
+		std::unique_ptr<Estimator> estimator;
+	};
+
+	/*Prevents from using copy constructor.*/
+	Preview(const Preview&);
+
+	/*Data members.*/
+	/***********************************************/
+	std::future<Loaded> pending;
+	std::shared_ptr<std::atomic<bool>> cancelled;
+	std::unique_ptr<StatsPyramid> stats;
+	std::unique_ptr<Estimator> estimator;
+	Estimate estimate;
+	ALLEGRO_BITMAP* bitmap;
+	std::string path, error;
+	double shown;
+	unsigned int side;
+	/***********************************************/
+};
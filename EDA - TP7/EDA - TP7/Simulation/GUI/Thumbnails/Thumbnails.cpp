@@ -0,0 +1,299 @@
+#include "Thumbnails.h"
+#include "../../QuadTree/QuadTree.h"
+#include "../../QuadTree/Codec/Codec.h"
+#include "../../QuadTree/PixelSink/PixelSink.h"
+#include <boost/filesystem.hpp>
+#include <functional>
+#include <sstream>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+
+namespace {
+	/*Thumbnail side, in pixels.*/
+	const unsigned int thumbSide = 32;
+	const unsigned int bytesPerPixel = 4;
+
+	/*Thumbnails are saved with this codec, inside the system's temporary directory.*/
+	const char* cacheFormat = "pam";
+	const char* cacheName = "EDA-TP7-thumbnails";
+
+	/*Disk cache limit, about 16000 thumbnails. Once it's exceeded, least recently
+	used ones are removed until it's down to pruneTo of it. It's checked when
+	Thumbnails is created and after every pruneEvery thumbnails saved.*/
+	const unsigned long long maxCacheBytes = 64ull << 20;
+	const double pruneTo = 0.75;
+	const unsigned int pruneEvery = 256;
+
+	/*Bitmaps uploaded per frame, so scrolling through new thumbnails doesn't stall.
+	Memory cache is cleared when it grows past its limit.*/
+	const unsigned int uploadsPerFrame = 64;
+	const unsigned int maxBitmaps = 4096;
+}
+
+/*Thumbnails constructor. Creates disk cache directory and starts worker threads.*/
+Thumbnails::Thumbnails(unsigned int threads) : running(0), saved(0), stopping(false) {
+	boost::system::error_code ec;
+	boost::filesystem::path dir = boost::filesystem::temp_directory_path(ec) / cacheName;
+
+	/*Without a cache directory, thumbnails are generated every time.*/
+	if (!ec && (boost::filesystem::is_directory(dir, ec) || boost::filesystem::create_directories(dir, ec)))
+		cacheDir = dir.string();
+	prune();
+
+	if (!threads)
+		threads = 1;
+	for (unsigned int i = 0; i < threads; i++)
+		workers.emplace_back(&Thumbnails::worker, this);
+}
+
+/*Returns the thumbnail of the given file if it's ready. Otherwise, it's
+requested and null is returned. 'compressed' tells if file is a compressed image.*/
+ALLEGRO_BITMAP* Thumbnails::get(const FileEntry& entry, bool compressed) {
+	const std::string key = makeKey(entry);
+	auto itr = bitmaps.find(key);
+
+	if (itr != bitmaps.end())
+		return itr->second;
+
+	bitmaps[key] = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		requests.push_front({ key, entry.fullPath, compressed, {} });
+	}
+	available.notify_one();
+	return nullptr;
+}
+
+/*Creates bitmaps of generated thumbnails. Must be called from the GUI thread.
+Returns true if any thumbnail became ready.*/
+bool Thumbnails::update(void) {
+	std::deque<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		for (unsigned int i = 0; i < uploadsPerFrame && finished.size(); i++) {
+			ready.push_back(std::move(finished.front()));
+			finished.pop_front();
+		}
+	}
+
+	for (auto& job : ready) {
+		auto itr = bitmaps.find(job.key);
+		if (itr == bitmaps.end() || itr->second || job.pixels.empty())
+			continue;
+
+		/*Locked region has RGBA byte order, like generated pixels.*/
+		ALLEGRO_BITMAP* bitmap = al_create_bitmap(thumbSide, thumbSide);
+		ALLEGRO_LOCKED_REGION* region = bitmap ? al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY) : nullptr;
+		if (!region) {
+			if (bitmap)
+				al_destroy_bitmap(bitmap);
+			continue;
+		}
+		for (unsigned int row = 0; row < thumbSide; row++)
+			memcpy((unsigned char*)region->data + (int)row * region->pitch, job.pixels.data() + row * thumbSide * bytesPerPixel, thumbSide * bytesPerPixel);
+		al_unlock_bitmap(bitmap);
+
+		itr->second = bitmap;
+	}
+
+	if (bitmaps.size() > maxBitmaps)
+		clear();
+
+	return ready.size();
+}
+
+/*Drops every bitmap and pending request. Disk cache is kept.*/
+void Thumbnails::clear(void) {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		requests.clear();
+		finished.clear();
+	}
+
+	for (auto& bitmap : bitmaps) {
+		if (bitmap.second)
+			al_destroy_bitmap(bitmap.second);
+	}
+	bitmaps.clear();
+}
+
+/*Checks if there are thumbnails being generated or waiting to be shown.*/
+bool Thumbnails::isBusy(void) {
+	std::lock_guard<std::mutex> lock(mtx);
+	return running || requests.size() || finished.size();
+}
+
+/*Getter.*/
+unsigned int Thumbnails::getSide(void) const { return thumbSide; }
+
+/*Worker thread loop. Serves latest requests first, until Thumbnails is destroyed.*/
+void Thumbnails::worker(void) {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			available.wait(lock, [this]() {return stopping || requests.size(); });
+
+			if (stopping)
+				return;
+
+			job = std::move(requests.front());
+			requests.pop_front();
+			running++;
+		}
+
+		/*Failed thumbnails are left empty.*/
+		bool isSaved = false;
+		try {
+			isSaved = generate(job);
+		}
+		catch (std::exception&) {
+			job.pixels.clear();
+		}
+
+		bool isFull = false;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			finished.push_back(std::move(job));
+			running--;
+			if (isSaved && ++saved == pruneEvery) {
+				saved = 0;
+				isFull = true;
+			}
+		}
+
+		if (isFull)
+			prune();
+	}
+}
+
+/*Loads job's thumbnail from disk cache or, if it's not there, generates it
+and saves it to disk cache. Returns true if it was saved. Cached thumbnails
+get their write time updated, so it tells when they were last used.*/
+bool Thumbnails::generate(Job& job) const {
+	const std::string cached = cacheDir.length() ? (boost::filesystem::path(cacheDir) / (job.key + '.' + cacheFormat)).string() : "";
+	const Codec& cacheCodec = Codec::get(cacheFormat);
+	std::vector<unsigned char> data;
+	unsigned char* pixels = nullptr;
+	unsigned int width, height;
+
+	/*A cached thumbnail can be pruned by another worker while it's read,
+	so failing to read it only means generating it again.*/
+	if (cached.length() && boost::filesystem::exists(cached)) {
+		try {
+			cacheCodec.decodeFile(cached, &pixels, &width, &height);
+			std::unique_ptr<unsigned char, freeDeleter> owner(pixels);
+
+			if (width == thumbSide && height == thumbSide) {
+				boost::system::error_code ec;
+				boost::filesystem::last_write_time(cached, std::time(nullptr), ec);
+				job.pixels.assign(pixels, pixels + thumbSide * thumbSide * bytesPerPixel);
+				return false;
+			}
+		}
+		catch (std::exception&) {}
+		pixels = nullptr;
+	}
+
+	Codec::readFile(job.path, data);
+
+	/*Compressed files are only filled as deep as needed.*/
+	if (job.compressed) {
+		BufferSink sink(job.pixels);
+		QuadTree().decompressShallow(data, thumbSide, sink);
+		width = sink.getWidth();
+		height = sink.getHeight();
+	}
+	else {
+		Codec::get(Codec::extension(job.path)).decode(data.data(), data.size(), &pixels, &width, &height);
+		std::unique_ptr<unsigned char, freeDeleter> owner(pixels);
+		job.pixels.assign(pixels, pixels + (size_t)width * height * bytesPerPixel);
+	}
+
+	/*Scales image to thumbnail side. Each thumbnail pixel is the mean of the block it covers.*/
+	std::vector<unsigned char> scaled(thumbSide * thumbSide * bytesPerPixel);
+	for (unsigned int row = 0; row < thumbSide; row++) {
+		const unsigned int top = row * height / thumbSide, bottom = std::max(top + 1, (row + 1) * height / thumbSide);
+		for (unsigned int col = 0; col < thumbSide; col++) {
+			const unsigned int left = col * width / thumbSide, right = std::max(left + 1, (col + 1) * width / thumbSide);
+			unsigned long long sum[bytesPerPixel] = {};
+
+			for (unsigned int i = top; i < bottom; i++) {
+				for (unsigned int j = left; j < right; j++) {
+					for (unsigned int c = 0; c < bytesPerPixel; c++)
+						sum[c] += job.pixels[((size_t)i * width + j) * bytesPerPixel + c];
+				}
+			}
+			for (unsigned int c = 0; c < bytesPerPixel; c++)
+				scaled[(row * thumbSide + col) * bytesPerPixel + c] = (unsigned char)(sum[c] / ((bottom - top) * (right - left)));
+		}
+	}
+	job.pixels.swap(scaled);
+
+	if (cached.length()) {
+		try {
+			cacheCodec.encodeFile(cached, job.pixels.data(), thumbSide, thumbSide);
+			return true;
+		}
+		catch (std::exception&) {}
+	}
+	return false;
+}
+
+/*Removes least recently used thumbnails from disk cache if it's over its
+limit. Files that can't be read or removed are skipped.*/
+void Thumbnails::prune(void) const {
+	if (!cacheDir.length())
+		return;
+
+	boost::system::error_code ec;
+	std::vector<std::pair<std::time_t, boost::filesystem::path>> files;
+	unsigned long long total = 0;
+
+	for (boost::filesystem::directory_iterator itr(cacheDir, ec), end; !ec && itr != end; itr.increment(ec)) {
+		const unsigned long long size = boost::filesystem::file_size(itr->path(), ec);
+		const std::time_t used = ec ? 0 : boost::filesystem::last_write_time(itr->path(), ec);
+		if (ec) {
+			ec.clear();
+			continue;
+		}
+		total += size;
+		files.emplace_back(used, itr->path());
+	}
+	if (total <= maxCacheBytes)
+		return;
+
+	/*Oldest first.*/
+	std::sort(files.begin(), files.end());
+	for (const auto& file : files) {
+		if (total <= maxCacheBytes * pruneTo)
+			break;
+		const unsigned long long size = boost::filesystem::file_size(file.second, ec);
+		if (!ec && boost::filesystem::remove(file.second, ec))
+			total -= size;
+		ec.clear();
+	}
+}
+
+/*Cache key. It changes whenever the file is modified.*/
+const std::string Thumbnails::makeKey(const FileEntry& entry) {
+	std::ostringstream key;
+	key << std::hex << std::hash<std::string>()(entry.fullPath) << '-' << entry.mtime << '-' << entry.size;
+	return key.str();
+}
+
+/*Thumbnails destructor. Stops workers after their current thumbnail and
+frees bitmaps. Must be destroyed before display.*/
+Thumbnails::~Thumbnails() {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	available.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+
+	clear();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <allegro5/allegro.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "../Filesystem/Filesystem.h"
+
+/*Generates small previews of listed images on background threads. Images are
+decoded and scaled down, and compressed files are only filled as deep as the
+thumbnail needs. Every thumbnail is saved to a disk cache keyed by path, mtime
+and size, so revisiting a folder doesn't decode anything. Disk cache is kept
+under a size limit by removing its least recently used thumbnails.*/
+class Thumbnails {
+public:
+	Thumbnails(unsigned int = 2);
+	~Thumbnails();
+
+	ALLEGRO_BITMAP* get(const FileEntry&, bool);
+	bool update(void);
+	void clear(void);
+
+	bool isBusy(void);
+	unsigned int getSide(void) const;
+
+private:
+	/*Thumbnail request, and its pixels once generated.*/
+	struct Job {
+		std::string key, path;
+		bool compressed;
+		std::vector<unsigned char> pixels;
+	};
+
+	void worker(void);
+	bool generate(Job&) const;
+	void prune(void) const;
+	static const std::string makeKey(const FileEntry&);
+
+	/*Prevents from using copy constructor.*/
+	Thumbnails(const Thumbnails&);
+
+	/*Data members.*/
+	/***********************************************/
+	std::string cacheDir;
+
+	/*GUI thread only. Null bitmaps are requested or failed thumbnails.*/
+	std::map<std::string, ALLEGRO_BITMAP*> bitmaps;
+
+	/*Shared with workers. Latest requests are served first.*/
+	std::deque<Job> requests, finished;
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	std::condition_variable available;
+	unsigned int running, saved;
+	bool stopping;
+	/***********************************************/
+};
@@ -0,0 +1,163 @@
+#include "Viewer.h"
+#include "../LockedBitmap/LockedBitmap.h"
+#include <algorithm>
+#include <thread>
+
+namespace {
+	/*Zoom limits, in view pixels per image pixel. Images can be shrunk
+	down to a quarter of the view at most.*/
+	const double maxScale = 64;
+	const double minFit = 0.25;
+}
+
+/*Viewer constructor. Nothing is open yet.*/
+Viewer::Viewer() : bitmap(nullptr), x(0), y(0), scale(1), width(0), height(0),
+opened(false), dirty(false), fitting(false) {}
+
+/*Starts loading compressed file at 'path' on a background thread.
+Previous file keeps being shown until it's ready.*/
+void Viewer::open(const std::string& path) {
+	opened = true;
+	if (path == this->path)
+		return;
+
+	this->path = path;
+	error.clear();
+
+	/*A previous load stops after reading, if it's not past it. As in Preview,
+	loads run on detached threads, so neither a new load nor the destructor
+	waits for one that's busy indexing.*/
+	if (cancelled)
+		*cancelled = true;
+	cancelled = std::make_shared<std::atomic<bool>>(false);
+
+	const auto promise = std::make_shared<std::promise<std::unique_ptr<TreeIndex>>>();
+	pending = promise->get_future();
+	std::thread([path, promise](std::shared_ptr<std::atomic<bool>> cancelled) {
+		try {
+			std::unique_ptr<TreeIndex> result(new TreeIndex);
+			std::vector<unsigned char> data;
+
+			Codec::readFile(path, data);
+			if (*cancelled)
+				return;
+			QuadTree().indexCompressed(data, *result);
+			promise->set_value(std::move(result));
+		}
+		catch (...) {
+			promise->set_exception(std::current_exception());
+		}
+		}, cancelled).detach();
+}
+
+/*Hides viewer. Open file is kept, so opening it again is immediate.*/
+void Viewer::close(void) { opened = false; }
+
+/*Takes loaded file, if there is one, and decompresses the visible region into
+a view of the given size if the view moved. Returns true if shown image changed.*/
+bool Viewer::update(unsigned int width, unsigned int height) {
+	if (pending.valid() && pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		try {
+			index = pending.get();
+			fitting = true;
+		}
+		catch (std::exception& e) {
+			error = e.what();
+			index.reset();
+		}
+	}
+
+	if (!index || !width || !height)
+		return false;
+
+	if (width != this->width || height != this->height) {
+		this->width = width;
+		this->height = height;
+		dirty = true;
+	}
+	if (fitting)
+		fit();
+
+	/*A tree that can't be decompressed is dropped, and its error shown.*/
+	try {
+		if (!dirty || !draw())
+			return false;
+	}
+	catch (std::exception& e) {
+		error = e.what();
+		index.reset();
+		return false;
+	}
+
+	dirty = false;
+	return true;
+}
+
+/*Moves view by the given amount of view pixels.*/
+void Viewer::pan(double dx, double dy) {
+	x -= dx / scale;
+	y -= dy / scale;
+	dirty = true;
+}
+
+/*Scales view by 'factor', keeping the image pixel under view pixel (px, py) in place.*/
+void Viewer::zoom(double factor, double px, double py) {
+	if (!index)
+		return;
+
+	const double fitScale = std::min(width, height) / (double)index->getSide();
+	const double newScale = std::min(std::max(scale * factor, fitScale * minFit), std::max(maxScale, fitScale));
+
+	x += px / scale - px / newScale;
+	y += py / scale - py / newScale;
+	scale = newScale;
+	dirty = true;
+}
+
+/*Centers whole image in the view.*/
+void Viewer::fit(void) {
+	fitting = !index || !width || !height;
+	if (fitting)
+		return;
+
+	scale = std::min(width, height) / (double)index->getSide();
+	x = (index->getSide() - width / scale) / 2;
+	y = (index->getSide() - height / scale) / 2;
+	dirty = true;
+}
+
+/*Decompresses visible region straight into bitmap, creating it if view size
+changed. Returns false if bitmap couldn't be created or locked.*/
+bool Viewer::draw(void) {
+	if (bitmap && ((unsigned int)al_get_bitmap_width(bitmap) != width || (unsigned int)al_get_bitmap_height(bitmap) != height)) {
+		al_destroy_bitmap(bitmap);
+		bitmap = nullptr;
+	}
+	if (!bitmap && !(bitmap = al_create_bitmap(width, height)))
+		return false;
+
+	LockedBitmap locked(bitmap);
+	if (!locked.getData())
+		return false;
+
+	qt.decompressRegion(*index, x, y, scale, locked.getData(), width, height, locked.getPitch(), locked.getLayout());
+	return true;
+}
+
+/*Getters.*/
+ALLEGRO_BITMAP* Viewer::getBitmap(void) const { return index ? bitmap : nullptr; }
+bool Viewer::isOpen(void) const { return opened; }
+bool Viewer::isLoading(void) const { return pending.valid(); }
+double Viewer::getScale(void) const { return scale; }
+unsigned int Viewer::getSide(void) const { return index ? index->getSide() : 0; }
+const std::string& Viewer::getPath(void) const { return path; }
+const std::string& Viewer::getError(void) const { return error; }
+
+/*Viewer destructor. Must be destroyed before display.
+Cancels a load still running, without waiting for it.*/
+Viewer::~Viewer() {
+	if (cancelled)
+		*cancelled = true;
+	if (bitmap)
+		al_destroy_bitmap(bitmap);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <allegro5/allegro.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <future>
+#include <memory>
+#include "../../QuadTree/QuadTree.h"
+#include "../../QuadTree/TreeIndex/TreeIndex.h"
+
+/*Pan and zoom viewer for compressed files. File is decoded and its tree
+indexed on a background thread. After that, only the visible region is
+decompressed, at the level of detail the current zoom needs.*/
+class Viewer {
+public:
+	Viewer();
+	~Viewer();
+
+	void open(const std::string&);
+	void close(void);
+	bool update(unsigned int, unsigned int);
+
+	void pan(double, double);
+	void zoom(double, double, double);
+	void fit(void);
+
+	ALLEGRO_BITMAP* getBitmap(void) const;
+	bool isOpen(void) const;
+	bool isLoading(void) const;
+	double getScale(void) const;
+	unsigned int getSide(void) const;
+	const std::string& getPath(void) const;
+	const std::string& getError(void) const;
+
+private:
+	bool draw(void);
+
+	/*Prevents from using copy constructor.*/
+	Viewer(const Viewer&);
+
+	/*Data members.*/
+	/***********************************************/
+	QuadTree qt;
+	std::future<std::unique_ptr<TreeIndex>> pending;
+	std::shared_ptr<std::atomic<bool>> cancelled;
+	std::unique_ptr<TreeIndex> index;
+	ALLEGRO_BITMAP* bitmap;
+	std::string path, error;
+	double x, y, scale;
+	unsigned int width, height;
+	bool opened, dirty, fitting;
+	/***********************************************/
+};
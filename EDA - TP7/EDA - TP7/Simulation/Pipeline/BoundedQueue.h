@@ -0,0 +1,61 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/*Thread safe FIFO with a maximum size. Producers block while it's full
+and consumers block while it's empty, until it's closed.*/
+template <class T>
+class BoundedQueue {
+public:
+	BoundedQueue(size_t capacity) : capacity(capacity ? capacity : 1), closed(false) {};
+
+	/*Pushes an item. Returns false if queue was closed.*/
+	bool push(T&& item) {
+		std::unique_lock<std::mutex> lock(mtx);
+		notFull.wait(lock, [this]() {return closed || items.size() < capacity; });
+
+		if (closed)
+			return false;
+
+		items.push_back(std::move(item));
+		lock.unlock();
+		notEmpty.notify_one();
+		return true;
+	}
+
+	/*Pops an item. Returns false once queue is closed and empty.*/
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(mtx);
+		notEmpty.wait(lock, [this]() {return closed || items.size(); });
+
+		if (items.empty())
+			return false;
+
+		item = std::move(items.front());
+		items.pop_front();
+		lock.unlock();
+		notFull.notify_one();
+		return true;
+	}
+
+	/*Closes queue. Remaining items can still be popped.*/
+	void close(void) {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			closed = true;
+		}
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+
+private:
+	/*Data members.*/
+	/***********************************************/
+	std::deque<T> items;
+	std::mutex mtx;
+	std::condition_variable notEmpty, notFull;
+	size_t capacity;
+	bool closed;
+	/***********************************************/
+};
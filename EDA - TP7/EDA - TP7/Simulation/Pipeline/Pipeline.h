@@ -0,0 +1,155 @@
+#pragma once
+#include "BoundedQueue.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <exception>
+
+/*Runs jobs through a sequence of stages. Each stage has its own worker
+threads and a bounded queue in front of it, so every stage works on a
+different job at the same time and throughput is limited by the slowest
+stage. T must have a std::string 'error' member. A job whose stage throws
+gets its error set and goes through the remaining stages untouched.
+If the optional cancel flag is set, jobs still in the pipeline are dropped.*/
+template <class T>
+class Pipeline {
+public:
+	/*Stage function. Gets job and a worker id that is unique across every stage.*/
+	using stageFunction = std::function<void(T&, unsigned int)>;
+
+	Pipeline(size_t queueSize) : queueSize(queueSize) {};
+
+	/*Adds a stage after the last one.*/
+	void addStage(const std::string& name, unsigned int workers, const stageFunction& apply) {
+		stages.push_back({ name, workers ? workers : 1, apply, 0, 0 });
+	}
+
+	/*Runs every job through every stage. 'done' is called from the
+	calling thread for each finished job, in completion order.*/
+	void run(std::vector<T> jobs, const std::function<void(T&)>& done, const std::atomic<bool>* cancel = nullptr) {
+		std::vector<std::unique_ptr<BoundedQueue<T>>> queues;
+		std::vector<std::thread> threads;
+		unsigned int id = 0;
+
+		for (unsigned int i = 0; i <= stages.size(); i++)
+			queues.emplace_back(new BoundedQueue<T>(queueSize));
+
+		/*Feeds jobs to first stage.*/
+		threads.emplace_back([&jobs, &queues, cancel]() {
+			for (auto& job : jobs) {
+				if (cancel && *cancel)
+					break;
+				queues.front()->push(std::move(job));
+			}
+			queues.front()->close();
+			});
+
+		/*Starts stage workers. Last worker of each stage to finish closes next queue.*/
+		std::vector<std::unique_ptr<std::atomic<unsigned int>>> running;
+		for (unsigned int s = 0; s < stages.size(); s++) {
+			Stage& stage = stages[s];
+			stage.busy = 0;
+			stage.count = 0;
+			running.emplace_back(new std::atomic<unsigned int>(stage.workers));
+
+			for (unsigned int w = 0; w < stage.workers; w++, id++) {
+				threads.emplace_back([this, &stage, &queues, &running, s, id, cancel]() {
+					T job;
+					double busy = 0;
+					unsigned int count = 0;
+
+					while (queues[s]->pop(job)) {
+						if (cancel && *cancel)
+							continue;
+
+						if (job.error.empty()) {
+							auto start = std::chrono::steady_clock::now();
+							try {
+								stage.apply(job, id);
+							}
+							catch (std::exception& e) {
+								job.error = stage.name + ": " + e.what();
+							}
+							busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+							count++;
+						}
+						queues[s + 1]->push(std::move(job));
+					}
+
+					{
+						std::lock_guard<std::mutex> lock(mtx);
+						stage.busy += busy;
+						stage.count += count;
+					}
+					if (!--(*running[s]))
+						queues[s + 1]->close();
+					});
+			}
+		}
+
+		/*Collects finished jobs.*/
+		T job;
+		while (queues.back()->pop(job))
+			done(job);
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	/*Average seconds each stage spent per job in the last run.*/
+	const std::vector<double> stageTimes(void) const {
+		std::vector<double> result;
+		for (const auto& stage : stages)
+			result.push_back(stage.count ? stage.busy / stage.count : 0);
+		return result;
+	}
+
+	/*Total amount of workers, which is also the amount of worker ids.*/
+	unsigned int workerCount(void) const {
+		unsigned int result = 0;
+		for (const auto& stage : stages)
+			result += stage.workers;
+		return result;
+	}
+
+	/*Splits 'threads' workers among stages proportionally to their cost,
+	with at least one worker per stage. Slowest stages get the most workers.*/
+	static const std::vector<unsigned int> balance(const std::vector<double>& costs, unsigned int threads) {
+		std::vector<unsigned int> result(costs.size(), 1);
+		double total = 0;
+
+		for (double cost : costs)
+			total += cost;
+
+		/*Gives each extra worker to the stage with the highest cost per worker.*/
+		for (unsigned int given = costs.size(); given < threads && total > 0; given++) {
+			unsigned int slowest = 0;
+			for (unsigned int i = 1; i < costs.size(); i++) {
+				if (costs[i] / result[i] > costs[slowest] / result[slowest])
+					slowest = i;
+			}
+			result[slowest]++;
+		}
+		return result;
+	}
+
+private:
+	struct Stage {
+		std::string name;
+		unsigned int workers;
+		stageFunction apply;
+		double busy;
+		unsigned int count;
+	};
+
+	/*Data members.*/
+	/***********************************************/
+	std::vector<Stage> stages;
+	std::mutex mtx;
+	size_t queueSize;
+	/***********************************************/
+};
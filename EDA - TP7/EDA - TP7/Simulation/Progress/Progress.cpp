@@ -0,0 +1,140 @@
+#include "Progress.h"
+#include <chrono>
+
+namespace {
+	const double bytesPerMB = 1024.0 * 1024.0;
+}
+
+/*Progress constructor. No batch has run yet.*/
+Progress::Progress() : done(0), failed(0), bytesIn(0), bytesOut(0), running(false),
+cancelled(false), startTime(0), endTime(0) {}
+
+/*******************************
+
+	   Batch thread side
+
+*******************************/
+
+/*Resets progress for a new batch with the given files.
+Must be called before the batch thread starts.*/
+void Progress::start(const std::vector<std::string>& files) {
+	std::lock_guard<std::mutex> lock(mtx);
+
+	names = files;
+	messages.assign(files.size(), "");
+	stats = CodecStats();
+	lastStats = CodecStats();
+	states = std::vector<std::atomic<int>>(files.size());
+	for (auto& state : states)
+		state = (int)FileState::PENDING;
+
+	done = 0;
+	failed = 0;
+	bytesIn = 0;
+	bytesOut = 0;
+	cancelled = false;
+	startTime = now();
+	endTime = 0;
+	running = true;
+}
+
+/*Marks file as being processed.*/
+void Progress::setRunning(unsigned int file) {
+	states[file] = (int)FileState::RUNNING;
+}
+
+/*Marks file as finished, with its input and output sizes.*/
+void Progress::setDone(unsigned int file, size_t inSize, size_t outSize) {
+	bytesIn += inSize;
+	bytesOut += outSize;
+	states[file] = (int)FileState::DONE;
+	done++;
+}
+
+/*Marks file as failed, saving its error message.*/
+void Progress::setFailed(unsigned int file, const std::string& msg) {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		messages[file] = msg;
+	}
+	states[file] = (int)FileState::FAILED;
+	failed++;
+}
+
+/*Adds a finished file's codec stats to batch totals.*/
+void Progress::addStats(const CodecStats& fileStats) {
+	std::lock_guard<std::mutex> lock(mtx);
+	stats.add(fileStats);
+	lastStats = fileStats;
+}
+
+/*Ends batch. Files that were never processed are marked as cancelled.*/
+void Progress::finish(void) {
+	for (auto& state : states) {
+		if (state == (int)FileState::PENDING || state == (int)FileState::RUNNING)
+			state = (int)FileState::CANCELLED;
+	}
+	endTime = now();
+	running = false;
+}
+
+/*Checked by batch threads before starting each file.*/
+bool Progress::isCancelled(void) const { return cancelled; }
+const std::atomic<bool>& Progress::cancelFlag(void) const { return cancelled; }
+
+/*******************************
+
+			GUI side
+
+*******************************/
+
+/*Asks batch threads to stop after the files they're working on.*/
+void Progress::cancel(void) { cancelled = true; }
+
+/*Getters.*/
+bool Progress::isRunning(void) const { return running; }
+unsigned int Progress::getTotal(void) const { return names.size(); }
+unsigned int Progress::getDone(void) const { return done; }
+unsigned int Progress::getFailed(void) const { return failed; }
+const std::string& Progress::getName(unsigned int file) const { return names[file]; }
+FileState Progress::getState(unsigned int file) const { return (FileState)states[file].load(); }
+
+/*Seconds since batch started, or batch duration if it already finished.*/
+double Progress::getElapsed(void) const {
+	if (!startTime)
+		return 0;
+	return (running ? now() : endTime.load()) - startTime;
+}
+
+/*Throughput, in files and input megabytes per second.*/
+double Progress::getFilesPerSecond(void) const {
+	double elapsed = getElapsed();
+	return elapsed > 0 ? done / elapsed : 0;
+}
+double Progress::getMBPerSecond(void) const {
+	double elapsed = getElapsed();
+	return elapsed > 0 ? bytesIn / bytesPerMB / elapsed : 0;
+}
+
+/*Returns error message of a failed file.*/
+const std::string Progress::getMessage(unsigned int file) {
+	std::lock_guard<std::mutex> lock(mtx);
+	return messages[file];
+}
+
+/*Returns codec stats of every file finished so far.*/
+const CodecStats Progress::getStats(void) {
+	std::lock_guard<std::mutex> lock(mtx);
+	return stats;
+}
+
+/*Returns codec stats of the last finished file.*/
+const CodecStats Progress::getLastStats(void) {
+	std::lock_guard<std::mutex> lock(mtx);
+	return lastStats;
+}
+
+/*Monotonic time in seconds.*/
+double Progress::now(void) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include "../QuadTree/CodecStats/CodecStats.h"
+
+/*Batch file states.*/
+/********************************/
+enum class FileState : int {
+	PENDING = 0,
+	RUNNING,
+	DONE,
+	FAILED,
+	CANCELLED
+};
+/********************************/
+
+/*Progress of a batch. Written by batch threads and read by the GUI every
+frame. Counters are atomic, so they can be read without locking.*/
+class Progress {
+public:
+	Progress();
+
+	/*Batch thread side.*/
+	/*************************************************************/
+	void start(const std::vector<std::string>&);
+	void setRunning(unsigned int);
+	void setDone(unsigned int, size_t, size_t);
+	void setFailed(unsigned int, const std::string&);
+	void addStats(const CodecStats&);
+	void finish(void);
+	bool isCancelled(void) const;
+	const std::atomic<bool>& cancelFlag(void) const;
+	/*************************************************************/
+
+	/*GUI side.*/
+	/*************************************************************/
+	void cancel(void);
+	bool isRunning(void) const;
+
+	unsigned int getTotal(void) const;
+	unsigned int getDone(void) const;
+	unsigned int getFailed(void) const;
+	double getElapsed(void) const;
+	double getFilesPerSecond(void) const;
+	double getMBPerSecond(void) const;
+
+	const std::string& getName(unsigned int) const;
+	FileState getState(unsigned int) const;
+	const std::string getMessage(unsigned int);
+	const CodecStats getStats(void);
+	const CodecStats getLastStats(void);
+	/*************************************************************/
+
+private:
+	static double now(void);
+
+	/*Prevents from using copy constructor.*/
+	Progress(const Progress&);
+
+	/*Data members.*/
+	/***********************************************/
+	std::vector<std::string> names, messages;
+	CodecStats stats, lastStats;
+	std::vector<std::atomic<int>> states;
+	std::atomic<unsigned int> done, failed;
+	std::atomic<unsigned long long> bytesIn, bytesOut;
+	std::atomic<bool> running, cancelled;
+	std::atomic<double> startTime, endTime;
+	std::mutex mtx;
+	/***********************************************/
+};
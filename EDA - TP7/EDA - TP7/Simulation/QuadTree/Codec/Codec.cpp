@@ -0,0 +1,588 @@
+#include "Codec.h"
+#include "lodepng.h"
+#include <map>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+/*Constants to use throughout codecs.*/
+/********************************************/
+namespace {
+	const unsigned int bytesPerPixel = 4;
+	const unsigned char opaque = 255;
+	const unsigned int maxSide = 1 << 16;
+	const unsigned int chunkSize = 1 << 16;
+	const char* stdStream = "-";
+}
+namespace qoi {
+	const unsigned char opIndex = 0x00;
+	const unsigned char opDiff = 0x40;
+	const unsigned char opLuma = 0x80;
+	const unsigned char opRun = 0xc0;
+	const unsigned char opRgb = 0xfe;
+	const unsigned char opRgba = 0xff;
+	const unsigned char mask = 0xc0;
+	const unsigned int headerSize = 14;
+	const unsigned int maxRun = 62;
+	const unsigned char padding[] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+}
+namespace bmp {
+	const unsigned int fileHeaderSize = 14;
+	const unsigned int infoHeaderSize = 108;
+	const unsigned int bitfields = 3;
+}
+/********************************************/
+
+/*Helpers shared by codecs.*/
+/********************************************/
+namespace {
+	/*Reads big/little endian unsigned values from a buffer. Bytes are widened
+	to unsigned before shifting, as shifting a high byte into an int's sign bit
+	is undefined.*/
+	unsigned int readBE32(const unsigned char* p) { return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3]; }
+	unsigned int readLE32(const unsigned char* p) { return p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24); }
+	unsigned int readLE16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+
+	/*Appends big/little endian unsigned values to a buffer.*/
+	void writeBE32(std::vector<unsigned char>& out, unsigned int v) {
+		for (int i = 3; i >= 0; i--)
+			out.push_back((v >> (8 * i)) & 0xff);
+	}
+	void writeLE32(std::vector<unsigned char>& out, unsigned int v) {
+		for (int i = 0; i < 4; i++)
+			out.push_back((v >> (8 * i)) & 0xff);
+	}
+	void writeLE16(std::vector<unsigned char>& out, unsigned int v) {
+		out.push_back(v & 0xff);
+		out.push_back((v >> 8) & 0xff);
+	}
+
+	/*Checks image size and allocates space for decoded pixels.*/
+	unsigned char* allocate(unsigned int w, unsigned int h) {
+		if (!w || !h || w > maxSide || h > maxSide)
+			throw std::exception("Invalid image size.");
+
+		unsigned char* pixels = (unsigned char*)malloc((size_t)w * h * bytesPerPixel);
+		if (!pixels)
+			throw std::exception("Memory allocation for file failed.");
+		return pixels;
+	}
+
+	/*Reads next token from a netpbm header, skipping whitespace and comments.*/
+	const std::string nextToken(const unsigned char* in, size_t size, size_t& pos) {
+		std::string token;
+
+		while (pos < size && (isspace(in[pos]) || in[pos] == '#')) {
+			if (in[pos] == '#')
+				while (pos < size && in[pos] != '\n') pos++;
+			else
+				pos++;
+		}
+		while (pos < size && !isspace(in[pos]))
+			token += in[pos++];
+
+		return token;
+	}
+
+	/*Lowercase format without initial '.'.*/
+	const std::string normalize(const std::string& format) {
+		size_t start = format.find_first_not_of('.');
+		std::string result = start == std::string::npos ? "" : format.substr(start);
+
+		std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+		return result;
+	}
+}
+/********************************************/
+
+/*PNG codec, backed by lodepng. When FAST_PNG is defined, it encodes
+with cheaper deflate settings (bigger files, much faster to write).*/
+class PngCodec : public Codec {
+public:
+	bool matches(const unsigned char* in, size_t size) const {
+		const unsigned char signature[] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+		return size >= sizeof(signature) && !memcmp(in, signature, sizeof(signature));
+	}
+
+	void decode(const unsigned char* in, size_t size, unsigned char** out, unsigned int* w, unsigned int* h) const {
+		unsigned int error = lodepng_decode32(out, w, h, in, size);
+		if (error) {
+			std::string errStr = "Failed to decode PNG. Lodepng error: " + (std::string)lodepng_error_text(error);
+			throw std::exception(errStr.c_str());
+		}
+		if (!*out)
+			throw std::exception("Memory allocation for file failed.");
+	}
+
+	void encode(std::vector<unsigned char>& out, const unsigned char* pixels, unsigned int w, unsigned int h) const {
+		unsigned char* buffer = nullptr;
+		size_t size = 0;
+		unsigned int error;
+
+#ifdef FAST_PNG
+		LodePNGState state;
+		lodepng_state_init(&state);
+		state.encoder.zlibsettings.windowsize = 2048;
+		state.encoder.zlibsettings.lazymatching = 0;
+		state.encoder.filter_strategy = LFS_ZERO;
+		error = lodepng_encode(&buffer, &size, pixels, w, h, &state);
+		lodepng_state_cleanup(&state);
+#else
+		error = lodepng_encode32(&buffer, &size, pixels, w, h);
+#endif
+
+		if (error) {
+			free(buffer);
+			std::string errStr = "Failed to encode PNG. Lodepng error: " + (std::string)lodepng_error_text(error);
+			throw std::exception(errStr.c_str());
+		}
+		out.assign(buffer, buffer + size);
+		free(buffer);
+	}
+};
+
+/*QOI codec ("Quite OK Image" format). Decodes several times faster than PNG.*/
+class QoiCodec : public Codec {
+public:
+	bool matches(const unsigned char* in, size_t size) const {
+		return size >= 4 && !memcmp(in, "qoif", 4);
+	}
+
+	void decode(const unsigned char* in, size_t size, unsigned char** out, unsigned int* w, unsigned int* h) const {
+		if (size < qoi::headerSize + sizeof(qoi::padding) || memcmp(in, "qoif", 4))
+			throw std::exception("Failed to decode QOI. Invalid header.");
+
+		*w = readBE32(in + 4);
+		*h = readBE32(in + 8);
+		*out = allocate(*w, *h);
+
+		unsigned char index[64 * bytesPerPixel] = { 0 };
+		unsigned char px[bytesPerPixel] = { 0, 0, 0, opaque };
+		size_t total = (size_t)(*w) * (*h) * bytesPerPixel;
+		size_t chunksEnd = size - sizeof(qoi::padding);
+		size_t p = qoi::headerSize;
+		unsigned int run = 0;
+
+		for (size_t pos = 0; pos < total; pos += bytesPerPixel) {
+			if (run)
+				run--;
+			else if (p < chunksEnd) {
+				unsigned char b1 = in[p++];
+
+				if (b1 == qoi::opRgb) {
+					memcpy(px, in + p, 3);
+					p += 3;
+				}
+				else if (b1 == qoi::opRgba) {
+					memcpy(px, in + p, 4);
+					p += 4;
+				}
+				else if ((b1 & qoi::mask) == qoi::opIndex)
+					memcpy(px, index + b1 * bytesPerPixel, bytesPerPixel);
+				else if ((b1 & qoi::mask) == qoi::opDiff) {
+					px[0] += ((b1 >> 4) & 0x03) - 2;
+					px[1] += ((b1 >> 2) & 0x03) - 2;
+					px[2] += (b1 & 0x03) - 2;
+				}
+				else if ((b1 & qoi::mask) == qoi::opLuma) {
+					unsigned char b2 = in[p++];
+					int vg = (b1 & 0x3f) - 32;
+					px[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+					px[1] += vg;
+					px[2] += vg - 8 + (b2 & 0x0f);
+				}
+				else
+					run = b1 & 0x3f;
+
+				unsigned int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+				memcpy(index + hash * bytesPerPixel, px, bytesPerPixel);
+			}
+			memcpy(*out + pos, px, bytesPerPixel);
+		}
+	}
+
+	void encode(std::vector<unsigned char>& out, const unsigned char* pixels, unsigned int w, unsigned int h) const {
+		out.clear();
+		out.reserve(qoi::headerSize + (size_t)w * h * 2);
+		out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+		writeBE32(out, w);
+		writeBE32(out, h);
+		out.push_back(bytesPerPixel);
+		out.push_back(0);
+
+		unsigned char index[64 * bytesPerPixel] = { 0 };
+		unsigned char prev[bytesPerPixel] = { 0, 0, 0, opaque };
+		size_t total = (size_t)w * h * bytesPerPixel;
+		unsigned int run = 0;
+
+		for (size_t pos = 0; pos < total; pos += bytesPerPixel) {
+			const unsigned char* px = pixels + pos;
+
+			/*Same pixel as before, so it extends the current run.*/
+			if (!memcmp(px, prev, bytesPerPixel)) {
+				if (++run == qoi::maxRun || pos + bytesPerPixel == total) {
+					out.push_back(qoi::opRun | (run - 1));
+					run = 0;
+				}
+				continue;
+			}
+
+			if (run) {
+				out.push_back(qoi::opRun | (run - 1));
+				run = 0;
+			}
+
+			unsigned int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+			if (!memcmp(index + hash * bytesPerPixel, px, bytesPerPixel))
+				out.push_back(qoi::opIndex | hash);
+			else {
+				memcpy(index + hash * bytesPerPixel, px, bytesPerPixel);
+
+				if (px[3] == prev[3]) {
+					signed char vr = px[0] - prev[0];
+					signed char vg = px[1] - prev[1];
+					signed char vb = px[2] - prev[2];
+					signed char vgr = vr - vg;
+					signed char vgb = vb - vg;
+
+					if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+						out.push_back(qoi::opDiff | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2));
+					else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+						out.push_back(qoi::opLuma | (vg + 32));
+						out.push_back(((vgr + 8) << 4) | (vgb + 8));
+					}
+					else
+						out.insert(out.end(), { qoi::opRgb, px[0], px[1], px[2] });
+				}
+				else
+					out.insert(out.end(), { qoi::opRgba, px[0], px[1], px[2], px[3] });
+			}
+			memcpy(prev, px, bytesPerPixel);
+		}
+		out.insert(out.end(), std::begin(qoi::padding), std::end(qoi::padding));
+	}
+};
+
+/*BMP codec. Reads uncompressed 24 and 32 bit bitmaps and writes 32 bit ones.*/
+class BmpCodec : public Codec {
+public:
+	bool matches(const unsigned char* in, size_t size) const {
+		return size >= 2 && in[0] == 'B' && in[1] == 'M';
+	}
+
+	void decode(const unsigned char* in, size_t size, unsigned char** out, unsigned int* w, unsigned int* h) const {
+		if (size < bmp::fileHeaderSize + 40 || in[0] != 'B' || in[1] != 'M')
+			throw std::exception("Failed to decode BMP. Invalid header.");
+
+		const unsigned char* info = in + bmp::fileHeaderSize;
+		unsigned int offset = readLE32(in + 10);
+		int width = (int)readLE32(info + 4);
+		int height = (int)readLE32(info + 8);
+		unsigned int bpp = readLE16(info + 14);
+		unsigned int compression = readLE32(info + 16);
+
+		if ((bpp != 24 && bpp != 32) || (compression && compression != bmp::bitfields) || width <= 0 || !height)
+			throw std::exception("Failed to decode BMP. Only uncompressed 24 and 32 bit images are supported.");
+
+		/*Channel masks. Default ones are for BGR(A) data.*/
+		unsigned int masks[bytesPerPixel] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0 };
+		if (compression == bmp::bitfields && size >= 70) {
+			for (unsigned int i = 0; i < bytesPerPixel - 1; i++)
+				masks[i] = readLE32(in + 54 + 4 * i);
+			if (readLE32(info) >= 56)
+				masks[bytesPerPixel - 1] = readLE32(in + 66);
+		}
+
+		/*Negative height means rows are stored top-down.*/
+		bool topDown = height < 0;
+		*w = width;
+		*h = topDown ? -height : height;
+
+		size_t stride = ((bpp * (size_t)(*w) + 31) / 32) * 4;
+		if (offset > size || stride * (*h) > size - offset)
+			throw std::exception("Failed to decode BMP. File is truncated.");
+
+		*out = allocate(*w, *h);
+
+		for (unsigned int i = 0; i < *h; i++) {
+			const unsigned char* row = in + offset + stride * (topDown ? i : *h - 1 - i);
+			unsigned char* dest = *out + (size_t)i * (*w) * bytesPerPixel;
+
+			for (unsigned int j = 0; j < *w; j++, dest += bytesPerPixel) {
+				if (bpp == 24) {
+					dest[0] = row[3 * j + 2];
+					dest[1] = row[3 * j + 1];
+					dest[2] = row[3 * j];
+					dest[3] = opaque;
+				}
+				else {
+					unsigned int value = readLE32(row + 4 * j);
+					for (unsigned int c = 0; c < bytesPerPixel; c++) {
+						unsigned int shift = 0;
+						if (!masks[c]) {
+							dest[c] = opaque;
+							continue;
+						}
+						while (!((masks[c] >> shift) & 1)) shift++;
+						dest[c] = (value & masks[c]) >> shift;
+					}
+				}
+			}
+		}
+	}
+
+	void encode(std::vector<unsigned char>& out, const unsigned char* pixels, unsigned int w, unsigned int h) const {
+		size_t dataSize = (size_t)w * h * bytesPerPixel;
+		unsigned int offset = bmp::fileHeaderSize + bmp::infoHeaderSize;
+
+		out.clear();
+		out.reserve(offset + dataSize);
+
+		/*File header.*/
+		out.insert(out.end(), { 'B', 'M' });
+		writeLE32(out, (unsigned int)(offset + dataSize));
+		writeLE32(out, 0);
+		writeLE32(out, offset);
+
+		/*BITMAPV4HEADER, with masks so alpha is kept.*/
+		writeLE32(out, bmp::infoHeaderSize);
+		writeLE32(out, w);
+		writeLE32(out, h);
+		writeLE16(out, 1);
+		writeLE16(out, 32);
+		writeLE32(out, bmp::bitfields);
+		writeLE32(out, (unsigned int)dataSize);
+		writeLE32(out, 2835);
+		writeLE32(out, 2835);
+		writeLE32(out, 0);
+		writeLE32(out, 0);
+		for (unsigned int mask : { 0x00ff0000u, 0x0000ff00u, 0x000000ffu, 0xff000000u })
+			writeLE32(out, mask);
+		writeLE32(out, 0x73524742);
+		out.resize(offset, 0);
+
+		/*Pixel data, bottom-up and in BGRA order.*/
+		for (unsigned int i = h; i-- > 0;) {
+			const unsigned char* row = pixels + (size_t)i * w * bytesPerPixel;
+			for (unsigned int j = 0; j < w; j++, row += bytesPerPixel)
+				out.insert(out.end(), { row[2], row[1], row[0], row[3] });
+		}
+	}
+};
+
+/*Netpbm codec. Handles binary PPM (P6, no alpha) and PAM (P7) images,
+which are trivial to read and write.*/
+class NetpbmCodec : public Codec {
+public:
+	NetpbmCodec(bool alpha) : alpha(alpha) {};
+
+	bool matches(const unsigned char* in, size_t size) const {
+		return size >= 2 && in[0] == 'P' && in[1] == (alpha ? '7' : '6');
+	}
+
+	void decode(const unsigned char* in, size_t size, unsigned char** out, unsigned int* w, unsigned int* h) const {
+		size_t pos = 0;
+		unsigned int depth = 3, maxval = 0;
+		*w = *h = 0;
+		const std::string magic = nextToken(in, size, pos);
+
+		if (magic == "P6") {
+			*w = std::atoi(nextToken(in, size, pos).c_str());
+			*h = std::atoi(nextToken(in, size, pos).c_str());
+			maxval = std::atoi(nextToken(in, size, pos).c_str());
+		}
+		else if (magic == "P7") {
+			std::string token;
+			while ((token = nextToken(in, size, pos)) != "ENDHDR" && token.length()) {
+				if (token == "WIDTH") *w = std::atoi(nextToken(in, size, pos).c_str());
+				else if (token == "HEIGHT") *h = std::atoi(nextToken(in, size, pos).c_str());
+				else if (token == "DEPTH") depth = std::atoi(nextToken(in, size, pos).c_str());
+				else if (token == "MAXVAL") maxval = std::atoi(nextToken(in, size, pos).c_str());
+				else nextToken(in, size, pos);
+			}
+		}
+		else
+			throw std::exception("Failed to decode netpbm image. Expected P6 or P7 header.");
+
+		/*Skips single whitespace after header.*/
+		pos++;
+
+		if (maxval != 255 || (depth != 3 && depth != bytesPerPixel))
+			throw std::exception("Failed to decode netpbm image. Only 8 bit RGB and RGBA images are supported.");
+
+		*out = allocate(*w, *h);
+
+		size_t pixels = (size_t)(*w) * (*h);
+		if (pos > size || pixels * depth > size - pos) {
+			free(*out);
+			*out = nullptr;
+			throw std::exception("Failed to decode netpbm image. File is truncated.");
+		}
+
+		if (depth == bytesPerPixel)
+			memcpy(*out, in + pos, pixels * bytesPerPixel);
+		else {
+			const unsigned char* src = in + pos;
+			unsigned char* dest = *out;
+			for (size_t i = 0; i < pixels; i++, src += 3, dest += bytesPerPixel) {
+				memcpy(dest, src, 3);
+				dest[3] = opaque;
+			}
+		}
+	}
+
+	void encode(std::vector<unsigned char>& out, const unsigned char* pixels, unsigned int w, unsigned int h) const {
+		const std::string header = alpha ?
+			"P7\nWIDTH " + std::to_string(w) + "\nHEIGHT " + std::to_string(h) + "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n" :
+			"P6\n" + std::to_string(w) + ' ' + std::to_string(h) + "\n255\n";
+		size_t count = (size_t)w * h;
+
+		out.assign(header.begin(), header.end());
+
+		if (alpha)
+			out.insert(out.end(), pixels, pixels + count * bytesPerPixel);
+		else {
+			out.reserve(out.size() + count * 3);
+			for (size_t i = 0; i < count; i++, pixels += bytesPerPixel)
+				out.insert(out.end(), pixels, pixels + 3);
+		}
+	}
+
+private:
+	bool alpha;
+};
+
+/*Codec registry. Holds every available codec, indexed by extension.*/
+/********************************************/
+namespace {
+	using codecMap = std::map<std::string, std::shared_ptr<Codec>>;
+
+	codecMap& registry() {
+		static codecMap codecs = {
+			{ "png", std::make_shared<PngCodec>() },
+			{ "qoi", std::make_shared<QoiCodec>() },
+			{ "bmp", std::make_shared<BmpCodec>() },
+			{ "ppm", std::make_shared<NetpbmCodec>(false) },
+			{ "pam", std::make_shared<NetpbmCodec>(true) },
+		};
+		return codecs;
+	}
+}
+/********************************************/
+
+/*Reads whole file and decodes it.*/
+void Codec::decodeFile(const std::string& fileName, unsigned char** out, unsigned int* w, unsigned int* h) const {
+	std::vector<unsigned char> data;
+	readFile(fileName, data);
+	decode(data.data(), data.size(), out, w, h);
+}
+
+/*Encodes pixels and writes them to file.*/
+void Codec::encodeFile(const std::string& fileName, const unsigned char* pixels, unsigned int w, unsigned int h) const {
+	std::vector<unsigned char> data;
+	encode(data, pixels, w, h);
+	writeFile(fileName, data);
+}
+
+/*Reads whole file into data. If fileName is '-', it reads stdin until EOF.*/
+void Codec::readFile(const std::string& fileName, std::vector<unsigned char>& data) {
+	data.clear();
+
+	if (fileName == stdStream) {
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		size_t read;
+		do {
+			data.resize(data.size() + chunkSize);
+			read = fread(data.data() + data.size() - chunkSize, 1, chunkSize, stdin);
+			data.resize(data.size() - chunkSize + read);
+		} while (read == chunkSize);
+
+		if (ferror(stdin))
+			throw std::exception("Failed to read from stdin.");
+	}
+	else {
+		std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+		if (!file)
+			throw std::exception(("Failed to open file " + fileName + '.').c_str());
+
+		data.resize((size_t)file.tellg());
+		file.seekg(0);
+		if (!file.read((char*)data.data(), data.size()))
+			throw std::exception(("Failed to read file " + fileName + '.').c_str());
+	}
+}
+
+/*Writes data to file. If fileName is '-', it writes to stdout.*/
+void Codec::writeFile(const std::string& fileName, const std::vector<unsigned char>& data) {
+	if (fileName == stdStream) {
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		if (fwrite(data.data(), 1, data.size(), stdout) != data.size() || fflush(stdout))
+			throw std::exception("Failed to write to stdout.");
+	}
+	else {
+		std::ofstream file(fileName, std::ios::binary);
+		if (!file.write((const char*)data.data(), data.size()))
+			throw std::exception(("Failed to write file " + fileName + '.').c_str());
+	}
+}
+
+/*Returns codec for given format. Format can be given with or without initial '.'.*/
+const Codec& Codec::get(const std::string& format) {
+	auto itr = registry().find(normalize(format));
+
+	if (itr == registry().end()) {
+		const std::string errStr = "No codec available for format ." + normalize(format) + '.';
+		throw std::exception(errStr.c_str());
+	}
+	return *itr->second;
+}
+
+/*Checks if there is a codec for given format.*/
+bool Codec::exists(const std::string& format) {
+	return registry().find(normalize(format)) != registry().end();
+}
+
+/*Registers (or replaces) codec for given format. Must be called before
+any compression starts, as the registry is not synchronized.*/
+void Codec::add(const std::string& format, const std::shared_ptr<Codec>& codec) {
+	registry()[normalize(format)] = codec;
+}
+
+/*Returns every registered format, without initial '.'.*/
+const std::vector<std::string> Codec::formats(void) {
+	std::vector<std::string> result;
+	for (const auto& codec : registry())
+		result.push_back(codec.first);
+	return result;
+}
+
+/*Returns codec whose magic bytes match the given data.*/
+const Codec& Codec::detect(const unsigned char* data, size_t size) {
+	for (const auto& codec : registry()) {
+		if (codec.second->matches(data, size))
+			return *codec.second;
+	}
+	throw std::exception("Unknown image format. No codec matches input data.");
+}
+
+/*Returns lowercase extension of filename (without '.'), or an empty string if it has none.*/
+const std::string Codec::extension(const std::string& filename) {
+	size_t pos = filename.find_last_of('.');
+	size_t slash = filename.find_last_of("\\/");
+
+	if (pos == std::string::npos || (slash != std::string::npos && slash > pos))
+		return "";
+	return normalize(filename.substr(pos + 1));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+
+/*Frees buffers allocated by codecs.*/
+struct freeDeleter {
+	void operator()(unsigned char* ptr) const { free(ptr); }
+};
+
+/*Image codec interface. Every codec works with 8 bit RGBA pixels,
+which is what QuadTree compresses and decompresses. Decoded buffers
+are allocated with malloc, so they can be freed like lodepng's.*/
+class Codec {
+public:
+	virtual ~Codec() {};
+
+	/*Decodes an encoded buffer to RGBA pixels.*/
+	virtual void decode(const unsigned char*, size_t, unsigned char**, unsigned int*, unsigned int*) const = 0;
+
+	/*Encodes RGBA pixels to a buffer.*/
+	virtual void encode(std::vector<unsigned char>&, const unsigned char*, unsigned int, unsigned int) const = 0;
+
+	/*Checks if encoded data starts with this codec's magic bytes.*/
+	virtual bool matches(const unsigned char*, size_t) const = 0;
+
+	/*File helpers built on top of decode and encode.*/
+	virtual void decodeFile(const std::string&, unsigned char**, unsigned int*, unsigned int*) const;
+	virtual void encodeFile(const std::string&, const unsigned char*, unsigned int, unsigned int) const;
+
+	/*Whole file I/O. The name '-' stands for stdin/stdout.*/
+	static void readFile(const std::string&, std::vector<unsigned char>&);
+	static void writeFile(const std::string&, const std::vector<unsigned char>&);
+
+	/*Codec registry, indexed by file extension (without '.').*/
+	/*************************************************************************/
+	static const Codec& get(const std::string&);
+	static bool exists(const std::string&);
+	static void add(const std::string&, const std::shared_ptr<Codec>&);
+	static const std::vector<std::string> formats(void);
+	static const Codec& detect(const unsigned char*, size_t);
+
+	static const std::string extension(const std::string&);
+	/*************************************************************************/
+};
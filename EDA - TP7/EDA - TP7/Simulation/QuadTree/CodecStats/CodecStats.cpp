@@ -0,0 +1,56 @@
+#include "CodecStats.h"
+#include "../Metrics/Metrics.h"
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+	const double bytesPerMB = 1024.0 * 1024.0;
+}
+
+/*CodecStats constructor. Every counter starts at 0.*/
+CodecStats::CodecStats() : decodeTime(0), buildTime(0), encodeTime(0), nodes(0), leaves(0), maxDepth(0),
+pixelsScanned(0), bytesIn(0), bytesOut(0), peakScratch(0), squaredError(0), samples(0), ssim(0), verified(0), calls(0) {}
+
+/*Adds another call's stats. Depth and scratch memory keep the largest.*/
+void CodecStats::add(const CodecStats& other) {
+	decodeTime += other.decodeTime;
+	buildTime += other.buildTime;
+	encodeTime += other.encodeTime;
+	nodes += other.nodes;
+	leaves += other.leaves;
+	maxDepth = std::max(maxDepth, other.maxDepth);
+	pixelsScanned += other.pixelsScanned;
+	bytesIn += other.bytesIn;
+	bytesOut += other.bytesOut;
+	peakScratch = std::max(peakScratch, other.peakScratch);
+	squaredError += other.squaredError;
+	samples += other.samples;
+	ssim += other.ssim;
+	verified += other.verified;
+	calls += other.calls;
+}
+
+/*Prints a one line summary, with each stage's share of the total time.*/
+void CodecStats::print(std::ostream& out) const {
+	const double total = decodeTime + buildTime + encodeTime;
+	const auto share = [total](double time) { return total > 0 ? 100 * time / total : 0; };
+
+	out << std::fixed << std::setprecision(3) << calls << " calls: decode " << decodeTime << " s (" << std::setprecision(0) << share(decodeTime)
+		<< "%), build " << std::setprecision(3) << buildTime << " s (" << std::setprecision(0) << share(buildTime)
+		<< "%), encode " << std::setprecision(3) << encodeTime << " s (" << std::setprecision(0) << share(encodeTime) << "%), "
+		<< nodes << " nodes, " << leaves << " leaves, depth " << maxDepth << ", " << pixelsScanned << " pixels scanned, "
+		<< std::setprecision(1) << bytesIn / bytesPerMB << " MB in, " << bytesOut / bytesPerMB << " MB out, peak scratch "
+		<< peakScratch / bytesPerMB << " MB";
+
+	if (samples)
+		out << ", PSNR " << std::setprecision(2) << getPSNR() << " dB";
+	if (verified)
+		out << ", SSIM " << std::setprecision(4) << getSSIM() << " (" << verified << " verified)";
+	out << std::defaultfloat << std::endl;
+}
+
+/*Returns PSNR of every compressed channel value, in dB.*/
+double CodecStats::getPSNR(void) const { return Metrics::psnr(squaredError, samples); }
+
+/*Returns mean SSIM of verified calls.*/
+double CodecStats::getSSIM(void) const { return verified ? ssim / verified : 0; }
@@ -0,0 +1,46 @@
+#pragma once
+#include <ostream>
+
+/*Where a codec call spent its time and memory. For compression, stages are
+image decoding, tree building and tree encoding. For decompression, they are
+tree decoding, tree walking and handing pixels to the sink. Stats of several
+calls can be added together, so batches can report their totals.*/
+struct CodecStats {
+	CodecStats();
+
+	void add(const CodecStats&);
+	void print(std::ostream&) const;
+
+	/*Quality of the calls' outputs. PSNR is infinite without loss, and SSIM is 0 if no call was verified.*/
+	double getPSNR(void) const;
+	double getSSIM(void) const;
+
+	/*Stage wall times, in seconds.*/
+	double decodeTime, buildTime, encodeTime;
+
+	/*Tree nodes visited and leaves emitted or filled, and the deepest leaf's level.*/
+	unsigned long long nodes, leaves;
+	unsigned int maxDepth;
+
+	/*Pixels read by threshold checks. Each check reads every pixel of its node.*/
+	unsigned long long pixelsScanned;
+
+	/*Encoded input size and output size. Decompression output is
+	raw pixels, as the sink does its own encoding.*/
+	unsigned long long bytesIn, bytesOut;
+
+	/*Largest amount of working memory the call had allocated at once, in bytes.
+	Totals keep the largest of every call.*/
+	unsigned long long peakScratch;
+
+	/*Squared error of leaves against the pixels they fill, added over every
+	color channel, and the amount of channel values compressed.*/
+	unsigned long long squaredError, samples;
+
+	/*SSIM of decompressed outputs against their images, added over verified calls, and their amount.*/
+	double ssim;
+	unsigned int verified;
+
+	/*Amount of calls added together.*/
+	unsigned int calls;
+};
@@ -0,0 +1,255 @@
+#include "Estimator.h"
+#include "../Codec/Codec.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+
+/*Constants to use throughout estimator. They match QuadTree's.*/
+/********************************************/
+namespace {
+	const unsigned int channels = 3;
+	const unsigned int bytesPerPixel = 4;
+	const unsigned int maxDif = 3 * 255;
+	const char* containerFormat = "png";
+
+	/*Tree data of inner nodes and leaves, as written by QuadTree.*/
+	const unsigned char hasChildren = 0;
+	const unsigned char noChildren = 1;
+
+	/*Tiles have 2^tileLog pixels per side, and at most maxSamples of them are
+	compressed by each estimate.*/
+	const unsigned int tileLog = 5;
+	const unsigned int maxSamples = 256;
+	const unsigned int seed = 1;
+
+	/*Bytes the container adds to the tree: its size and padding to whole pixels.*/
+	const unsigned int headerBytes = 4;
+}
+/********************************************/
+
+/*Estimator constructor. Downsamples the given image, whose side is a power
+of 2, to one cell per tile, and builds their statistics up to the root. It's a
+single read of the pixels that doesn't depend on threshold, so it's done once
+per image.*/
+Estimator::Estimator(const unsigned char* pixels, unsigned int side, SplitCriterion criterion) : pixels(pixels), side(side), criterion(criterion) {
+	for (gridLog = 0; (side >> gridLog) > (1u << tileLog); gridLog++) {};
+	tileSide = side >> gridLog;
+
+	levels.assign(gridLog + 1, std::vector<Cell>());
+	for (unsigned int level = 0; level <= gridLog; level++)
+		levels[level].resize((size_t)1 << (2 * level));
+
+	/*Tiles, from their points.*/
+	const unsigned int grid = 1 << gridLog;
+	for (unsigned int row = 0; row < grid; row++) {
+		for (unsigned int col = 0; col < grid; col++)
+			poolTile(row, col, levels[gridLog][(size_t)row * grid + col]);
+	}
+
+	/*Upper levels, from their four children.*/
+	for (unsigned int level = gridLog; level-- > 0;) {
+		const unsigned int levelSide = 1 << level;
+		const std::vector<Cell>& below = levels[level + 1];
+
+		for (unsigned int row = 0; row < levelSide; row++) {
+			for (unsigned int col = 0; col < levelSide; col++) {
+				Cell& cell = levels[level][(size_t)row * levelSide + col];
+				cell = below[(size_t)2 * row * 2 * levelSide + 2 * col];
+
+				for (unsigned int i = 1; i < 4; i++) {
+					const Cell& child = below[(size_t)(2 * row + i / 2) * 2 * levelSide + 2 * col + i % 2];
+					for (unsigned int c = 0; c < channels; c++) {
+						cell.sum[c] += child.sum[c];
+						cell.sumSq[c] += child.sumSq[c];
+						cell.min[c] = std::min(cell.min[c], child.min[c]);
+						cell.max[c] = std::max(cell.max[c], child.max[c]);
+					}
+					cell.count += child.count;
+				}
+			}
+		}
+	}
+}
+
+/*Downsamples a tile into 'cell'. Channel ranges are kept, instead of
+averaged away, so split decisions of the blocks above it are exact.*/
+void Estimator::poolTile(unsigned int row, unsigned int col, Cell& cell) const {
+	for (unsigned int c = 0; c < channels; c++) {
+		cell.sum[c] = cell.sumSq[c] = 0;
+		cell.min[c] = 255;
+		cell.max[c] = 0;
+	}
+	cell.count = tileSide * tileSide;
+
+	for (unsigned int i = 0; i < tileSide; i++) {
+		const unsigned char* pixel = pixels + (((size_t)row * tileSide + i) * side + (size_t)col * tileSide) * bytesPerPixel;
+		uint64_t sum[channels] = {}, sumSq[channels] = {};
+
+		for (unsigned int j = 0; j < tileSide; j++, pixel += bytesPerPixel) {
+			for (unsigned int c = 0; c < channels; c++) {
+				sum[c] += pixel[c];
+				sumSq[c] += pixel[c] * pixel[c];
+				cell.min[c] = std::min(cell.min[c], pixel[c]);
+				cell.max[c] = std::max(cell.max[c], pixel[c]);
+			}
+		}
+		for (unsigned int c = 0; c < channels; c++) {
+			cell.sum[c] += sum[c];
+			cell.sumSq[c] += sumSq[c];
+		}
+	}
+}
+
+/*Estimates result of compressing the image at the given threshold.*/
+const Estimate Estimator::estimate(const double threshold) const {
+	const auto start = std::chrono::steady_clock::now();
+	Estimate result = {};
+	std::vector<unsigned int> reached;
+	std::vector<unsigned char> tree, tiles;
+	double upperError = 0;
+
+	/*Levels down to tiles, whose decisions are exact. Tiles that split are left in 'reached'.*/
+	upperNode(0, 0, 0, threshold, reached, tree, result, upperError);
+	const double upperNodes = result.nodes, upperLeaves = result.leaves;
+
+	/*Node counts of split tiles vary wildly, and grow with their spread. Sorting
+	them by spread and taking one random tile from each of 'samples' equal
+	strata keeps tiles of every spread in the sample.*/
+	std::stable_sort(reached.begin(), reached.end(), [this](unsigned int a, unsigned int b) {
+		return spread(levels[gridLog][a]) < spread(levels[gridLog][b]); });
+
+	/*Compresses sampled tiles. They're copied, as statistics need their pixels contiguous.*/
+	const unsigned int samples = std::min((unsigned int)reached.size(), maxSamples);
+	const double step = samples ? (double)reached.size() / samples : 0;
+	const size_t rowBytes = (size_t)tileSide * bytesPerPixel;
+	uint64_t tileError = 0;
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<double> jitter(0, 1);
+
+	result.nodes = result.leaves = 0;
+	for (unsigned int i = 0; i < samples; i++) {
+		const unsigned int tile = reached[std::min(reached.size() - 1, (size_t)((i + jitter(random)) * step))];
+		const unsigned int row = tile >> gridLog, col = tile & ((1 << gridLog) - 1);
+
+		std::unique_ptr<unsigned char, freeDeleter> copy((unsigned char*)malloc(rowBytes * tileSide));
+		if (!copy)
+			throw std::exception("Failed to allocate memory.");
+		for (unsigned int line = 0; line < tileSide; line++)
+			memcpy(copy.get() + line * rowBytes, pixels + (((size_t)row * tileSide + line) * side + (size_t)col * tileSide) * bytesPerPixel, rowBytes);
+
+		StatsPyramid stats;
+		stats.build(std::move(copy), tileSide);
+		stats.setCriterion(criterion);
+		tileNode(stats, 0, 0, 0, threshold, gridLog, tiles, result);
+		tileError += stats.squaredError(threshold);
+	}
+
+	/*Scales sampled tiles to every split one.*/
+	const double scale = samples ? (double)reached.size() / samples : 0;
+	const double treeBytes = tree.size() + scale * tiles.size() + headerBytes;
+	result.nodes = upperNodes + scale * result.nodes;
+	result.leaves = upperLeaves + scale * result.leaves;
+	result.sampledTiles = samples;
+	result.reachedTiles = reached.size();
+
+	/*Container's compression ratio is measured on the tree bytes seen.*/
+	tree.insert(tree.end(), tiles.begin(), tiles.end());
+	tree.resize((tree.size() / bytesPerPixel + 1) * bytesPerPixel, 0);
+	std::vector<unsigned char> encoded;
+	Codec::get(containerFormat).encode(encoded, tree.data(), tree.size() / bytesPerPixel, 1);
+	result.bytes = treeBytes * encoded.size() / tree.size();
+
+	const double error = upperError + scale * tileError;
+	result.psnr = error > 0 ? 10 * log10(255.0 * 255.0 * side * side * channels / error) : std::numeric_limits<double>::infinity();
+
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+/*Sets criterion of later estimates.*/
+void Estimator::setCriterion(SplitCriterion value) { criterion = value; }
+
+/*Returns how much cell's pixels differ, as the criterion measures it:
+its channel ranges added, or its channel variances added.*/
+double Estimator::spread(const Cell& cell) const {
+	double value = 0;
+	for (unsigned int c = 0; c < channels; c++) {
+		if (criterion == SplitCriterion::VARIANCE) {
+			const double mean = cell.sum[c] / cell.count;
+			value += cell.sumSq[c] / cell.count - mean * mean;
+		}
+		else
+			value += cell.max[c] - cell.min[c];
+	}
+	return value;
+}
+
+/*Checks if cell is a leaf at the given threshold, as StatsPyramid::isLeaf does.*/
+bool Estimator::isLeaf(const Cell& cell, const double threshold) const {
+	if (criterion == SplitCriterion::VARIANCE)
+		return StatsPyramid::isSmooth((double)cell.count, cell.sum, cell.sumSq, threshold);
+
+	unsigned int value = 0;
+	for (unsigned int c = 0; c < channels; c++)
+		value += cell.max[c] - cell.min[c];
+	return value <= threshold * maxDif;
+}
+
+/*Recursively decides a node from its cell, down to tile level. Tiles that
+split are added to 'reached' instead, to be sampled. Leaves add the error of
+filling their pixels with their truncated mean, as QuadTree does.*/
+void Estimator::upperNode(unsigned int level, unsigned int row, unsigned int col, const double threshold,
+	std::vector<unsigned int>& reached, std::vector<unsigned char>& tree, Estimate& result, double& error) const {
+	const Cell& cell = levels[level][((size_t)row << level) + col];
+	const bool leaf = isLeaf(cell, threshold);
+
+	if (!leaf && level == gridLog) {
+		reached.push_back((row << gridLog) + col);
+		return;
+	}
+
+	result.nodes++;
+	if (leaf) {
+		tree.push_back(noChildren);
+		for (unsigned int c = 0; c < channels; c++) {
+			const double mean = floor(cell.sum[c] / cell.count);
+			tree.push_back((unsigned char)mean);
+			error += cell.sumSq[c] - 2 * mean * cell.sum[c] + cell.count * mean * mean;
+		}
+		result.leaves++;
+		result.maxDepth = std::max(result.maxDepth, level);
+		return;
+	}
+
+	tree.push_back(hasChildren);
+	for (unsigned int i = 0; i < 4; i++)
+		upperNode(level + 1, 2 * row + i / 2, 2 * col + i % 2, threshold, reached, tree, result, error);
+}
+
+/*Recursively compresses a sampled tile's node, as QuadTree does from its statistics.
+'depth' is the tile's level in the whole image's tree.*/
+void Estimator::tileNode(const StatsPyramid& stats, unsigned int level, unsigned int row, unsigned int col, const double threshold,
+	unsigned int depth, std::vector<unsigned char>& tree, Estimate& result) const {
+	result.nodes++;
+
+	if (stats.isLeaf(level, row, col, threshold)) {
+		unsigned char rgb[channels];
+		stats.getColor(level, row, col, rgb);
+
+		tree.push_back(noChildren);
+		tree.insert(tree.end(), rgb, rgb + channels);
+		result.leaves++;
+		result.maxDepth = std::max(result.maxDepth, depth + level);
+		return;
+	}
+
+	tree.push_back(hasChildren);
+	for (unsigned int i = 0; i < 4; i++)
+		tileNode(stats, level + 1, 2 * row + i / 2, 2 * col + i % 2, threshold, depth, tree, result);
+}
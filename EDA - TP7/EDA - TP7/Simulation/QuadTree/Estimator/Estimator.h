@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include "../StatsPyramid/StatsPyramid.h"
+
+/*Estimated result of compressing an image at a threshold. Counts are
+extrapolated from samples, so they aren't integers.*/
+struct Estimate {
+	double nodes, leaves, bytes, psnr;
+	unsigned int maxDepth;
+
+	/*Split tiles analyzed exactly, out of every split tile.*/
+	unsigned int sampledTiles, reachedTiles;
+
+	/*Seconds taken by the estimate, not counting image decoding or downsampling.*/
+	double seconds;
+};
+
+/*Predicts node count, compressed size and PSNR of a square RGBA image at any
+threshold without compressing it. The image is downsampled to one cell per
+tile, keeping each tile's channel ranges and sums, so tree levels down to tiles
+are decided with the same criterion as QuadTree. Tiles that split are then
+sorted by range or variance, and a stratified sample of them is compressed
+exactly, with its results scaled to every split tile. Image pixels are not
+copied, so they must outlive the estimator.*/
+class Estimator {
+public:
+	Estimator(const unsigned char*, unsigned int, SplitCriterion = SplitCriterion::RANGE);
+
+	void setCriterion(SplitCriterion);
+
+	const Estimate estimate(const double) const;
+
+private:
+	/*Statistics of a block of tiles.*/
+	struct Cell {
+		double sum[3], sumSq[3];
+		unsigned char min[3], max[3];
+		unsigned long long count;
+	};
+
+	void poolTile(unsigned int, unsigned int, Cell&) const;
+	double spread(const Cell&) const;
+	bool isLeaf(const Cell&, const double) const;
+	void upperNode(unsigned int, unsigned int, unsigned int, const double, std::vector<unsigned int>&, std::vector<unsigned char>&, Estimate&, double&) const;
+	void tileNode(const StatsPyramid&, unsigned int, unsigned int, unsigned int, const double, unsigned int, std::vector<unsigned char>&, Estimate&) const;
+
+	/*Prevents from using copy constructor.*/
+	Estimator(const Estimator&);
+
+	/*Data members.*/
+	/***********************************************/
+	const unsigned char* pixels;
+	unsigned int side, tileSide, gridLog;
+	SplitCriterion criterion;
+	std::vector<std::vector<Cell>> levels;
+	/***********************************************/
+};
@@ -0,0 +1,217 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/*SSE2 is part of every x64 target, and of x86 ones built with /arch:SSE2 or -msse2.*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define METRICS_SSE2
+#include <emmintrin.h>
+#endif
+
+/*Metrics settings.*/
+/********************************************/
+namespace {
+	const unsigned int channels = 3;
+	const unsigned int bytesPerPixel = 4;
+	const double peak = 255.0;
+
+	/*SSIM block side and stabilizing constants, for 8 bit values.*/
+	const unsigned int ssimBlock = 8;
+	const double c1 = (0.01 * peak) * (0.01 * peak);
+	const double c2 = (0.03 * peak) * (0.03 * peak);
+
+	/*Channel sums of a block of both images, with alpha in the last position.*/
+	struct BlockSums {
+		uint32_t x[bytesPerPixel], y[bytesPerPixel], xx[bytesPerPixel], yy[bytesPerPixel], xy[bytesPerPixel];
+	};
+
+#ifdef METRICS_SSE2
+	/*Vector loops add at most 2 * 2 * 255^2 to each 32 bit lane per iteration,
+	so lanes are moved to 64 bits after this many iterations, before they overflow.*/
+	const unsigned int flushEvery = 4096;
+
+	uint64_t laneSum(__m128i lanes) {
+		uint32_t values[4];
+		_mm_storeu_si128((__m128i*)values, lanes);
+		return (uint64_t)values[0] + values[1] + values[2] + values[3];
+	}
+
+	/*Adds a vector of eight 16 bit values, squared or multiplied, to four 32 bit lanes.
+	Products of 8 bit values fit 16 bits unsigned, so they're widened with zeros.*/
+	__m128i addProducts(__m128i acc, __m128i a, __m128i b) {
+		const __m128i product = _mm_mullo_epi16(a, b);
+		const __m128i zero = _mm_setzero_si128();
+		return _mm_add_epi32(acc, _mm_add_epi32(_mm_unpacklo_epi16(product, zero), _mm_unpackhi_epi16(product, zero)));
+	}
+#endif
+
+	/*Squared error of 'pixels' pixels of 'a' against 'b'. If 'repeat' is set,
+	'b' holds a single pixel, repeated four times, instead of a run.*/
+	uint64_t runError(const unsigned char* a, const unsigned char* b, size_t pixels, bool repeat) {
+		uint64_t result = 0;
+		size_t i = 0;
+
+#ifdef METRICS_SSE2
+		/*Four pixels at a time. Alpha is masked out of both, so it adds nothing.*/
+		const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i pattern = repeat ? _mm_and_si128(_mm_loadu_si128((const __m128i*)b), colorMask) : zero;
+		__m128i acc = zero;
+		unsigned int pending = 0;
+
+		for (; i + 4 <= pixels; i += 4) {
+			const __m128i x = _mm_and_si128(_mm_loadu_si128((const __m128i*)(a + i * bytesPerPixel)), colorMask);
+			const __m128i y = repeat ? pattern : _mm_and_si128(_mm_loadu_si128((const __m128i*)(b + i * bytesPerPixel)), colorMask);
+			const __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero));
+			const __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero));
+
+			acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high)));
+			if (++pending == flushEvery) {
+				result += laneSum(acc);
+				acc = zero;
+				pending = 0;
+			}
+		}
+		result += laneSum(acc);
+#endif
+
+		/*Remaining pixels, or every pixel without SSE2.*/
+		for (; i < pixels; i++) {
+			const unsigned char* y = repeat ? b : b + i * bytesPerPixel;
+			for (unsigned int c = 0; c < channels; c++) {
+				const int dif = (int)a[i * bytesPerPixel + c] - y[c];
+				result += dif * dif;
+			}
+		}
+		return result;
+	}
+
+	/*Sums of a square block of 'side' pixels of both images, which share 'pitch'.*/
+	void blockSums(const unsigned char* a, const unsigned char* b, size_t pitch, unsigned int side, BlockSums& sums) {
+#ifdef METRICS_SSE2
+		/*Each row of a full block is two vectors of four pixels. Products are
+		kept in 32 bit lanes, and plain sums in 16 bit ones, where 32 values fit.*/
+		if (side == ssimBlock) {
+			const __m128i zero = _mm_setzero_si128();
+			__m128i sx = zero, sy = zero, sxx = zero, syy = zero, sxy = zero;
+
+			for (unsigned int row = 0; row < side; row++) {
+				for (unsigned int half = 0; half < 2; half++) {
+					const size_t offset = row * pitch + half * 4 * bytesPerPixel;
+					const __m128i x = _mm_loadu_si128((const __m128i*)(a + offset));
+					const __m128i y = _mm_loadu_si128((const __m128i*)(b + offset));
+					const __m128i xLow = _mm_unpacklo_epi8(x, zero), xHigh = _mm_unpackhi_epi8(x, zero);
+					const __m128i yLow = _mm_unpacklo_epi8(y, zero), yHigh = _mm_unpackhi_epi8(y, zero);
+
+					sx = _mm_add_epi16(sx, _mm_add_epi16(xLow, xHigh));
+					sy = _mm_add_epi16(sy, _mm_add_epi16(yLow, yHigh));
+					sxx = addProducts(addProducts(sxx, xLow, xLow), xHigh, xHigh);
+					syy = addProducts(addProducts(syy, yLow, yLow), yHigh, yHigh);
+					sxy = addProducts(addProducts(sxy, xLow, yLow), xHigh, yHigh);
+				}
+			}
+
+			/*Both pixels of each 16 bit sum vector belong to the same channels.*/
+			sx = _mm_add_epi32(_mm_unpacklo_epi16(sx, zero), _mm_unpackhi_epi16(sx, zero));
+			sy = _mm_add_epi32(_mm_unpacklo_epi16(sy, zero), _mm_unpackhi_epi16(sy, zero));
+			_mm_storeu_si128((__m128i*)sums.x, sx);
+			_mm_storeu_si128((__m128i*)sums.y, sy);
+			_mm_storeu_si128((__m128i*)sums.xx, sxx);
+			_mm_storeu_si128((__m128i*)sums.yy, syy);
+			_mm_storeu_si128((__m128i*)sums.xy, sxy);
+			return;
+		}
+#endif
+
+		sums = BlockSums();
+		for (unsigned int row = 0; row < side; row++) {
+			for (unsigned int col = 0; col < side; col++) {
+				const size_t offset = row * pitch + col * bytesPerPixel;
+				for (unsigned int c = 0; c < channels; c++) {
+					const uint32_t x = a[offset + c], y = b[offset + c];
+					sums.x[c] += x;
+					sums.y[c] += y;
+					sums.xx[c] += x * x;
+					sums.yy[c] += y * y;
+					sums.xy[c] += x * y;
+				}
+			}
+		}
+	}
+}
+/********************************************/
+
+/*Returns squared error of 'pixels' RGBA pixels of 'a' against 'b'.*/
+uint64_t Metrics::squaredError(const unsigned char* a, const unsigned char* b, size_t pixels) {
+	return runError(a, b, pixels, false);
+}
+
+/*Returns squared error of filling a block with 'rgb'. Each row is compared
+against a vector of the color, so leaves are checked at the same speed as images.*/
+uint64_t Metrics::fillError(const unsigned char* start, size_t pitch, unsigned int width, unsigned int height, const unsigned char* rgb) {
+	unsigned char pattern[4 * bytesPerPixel] = {};
+	uint64_t result = 0;
+
+	for (unsigned int i = 0; i < 4; i++)
+		std::copy(rgb, rgb + channels, pattern + i * bytesPerPixel);
+
+	for (unsigned int row = 0; row < height; row++)
+		result += runError(start + row * pitch, pattern, width, true);
+	return result;
+}
+
+/*Returns mean SSIM of two RGBA images. Each channel of each block gets
+(2 mx my + c1)(2 cov + c2) / ((mx^2 + my^2 + c1)(vx + vy + c2)), from its sums.
+Images smaller than a block are taken as a single block, and partial blocks
+on the right and bottom edges are left out.*/
+double Metrics::ssim(const unsigned char* a, const unsigned char* b, unsigned int width, unsigned int height) {
+	const unsigned int side = std::min(ssimBlock, std::min(width, height));
+	const size_t pitch = (size_t)width * bytesPerPixel;
+	const double count = (double)side * side;
+	BlockSums sums;
+	double total = 0;
+	size_t blocks = 0;
+
+	if (!side)
+		return 1;
+
+	for (unsigned int row = 0; row + side <= height; row += side) {
+		for (unsigned int col = 0; col + side <= width; col += side, blocks++) {
+			const size_t offset = row * pitch + (size_t)col * bytesPerPixel;
+			blockSums(a + offset, b + offset, pitch, side, sums);
+
+			for (unsigned int c = 0; c < channels; c++) {
+				const double mx = sums.x[c] / count, my = sums.y[c] / count;
+				const double vx = sums.xx[c] / count - mx * mx, vy = sums.yy[c] / count - my * my;
+				const double cov = sums.xy[c] / count - mx * my;
+
+				total += (2 * mx * my + c1) * (2 * cov + c2) / ((mx * mx + my * my + c1) * (vx + vy + c2));
+			}
+		}
+	}
+	return total / (blocks * channels);
+}
+
+/*Returns PSNR of a squared error. It's infinite if there's no error.*/
+double Metrics::psnr(uint64_t error, uint64_t samples) {
+	if (!error || !samples)
+		return std::numeric_limits<double>::infinity();
+	return 10 * log10(peak * peak * samples / error);
+}
+
+/*Returns MSE, PSNR and SSIM of 'b' against 'a', two RGBA images of the same size.*/
+const Quality Metrics::compare(const unsigned char* a, const unsigned char* b, unsigned int width, unsigned int height) {
+	const uint64_t samples = (uint64_t)width * height * channels;
+	const uint64_t error = squaredError(a, b, (size_t)width * height);
+
+	return { error, samples, samples ? (double)error / samples : 0, psnr(error, samples), ssim(a, b, width, height) };
+}
+
+bool Metrics::isVectorized(void) {
+#ifdef METRICS_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/*Quality of a reconstructed image against its original, with the squared
+error and amount of channel values the MSE comes from, so qualities of several
+images can be pooled. PSNR is infinite for identical images, and SSIM is 1.*/
+struct Quality {
+	uint64_t squaredError, samples;
+	double mse, psnr, ssim;
+};
+
+/*Quality metrics of RGBA images, over their color channels. Alpha is ignored,
+as trees don't keep it. Kernels use SSE2 where the compiler targets it, and
+plain loops otherwise, giving the same results.*/
+class Metrics {
+public:
+	/*Squared error added over every color channel of two pixel runs.*/
+	static uint64_t squaredError(const unsigned char*, const unsigned char*, size_t);
+
+	/*Squared error of filling a block, given by its start, pitch in bytes,
+	width and height in pixels, with a single RGB color.*/
+	static uint64_t fillError(const unsigned char*, size_t, unsigned int, unsigned int, const unsigned char*);
+
+	/*Mean SSIM of two images of the same size, over 8x8 blocks of every color channel.*/
+	static double ssim(const unsigned char*, const unsigned char*, unsigned int, unsigned int);
+
+	/*PSNR, in dB, of a squared error added over 'samples' channel values.*/
+	static double psnr(uint64_t, uint64_t);
+
+	static const Quality compare(const unsigned char*, const unsigned char*, unsigned int, unsigned int);
+
+	/*Whether kernels were compiled with SSE2.*/
+	static bool isVectorized(void);
+};
@@ -0,0 +1,125 @@
+#include "PixelSink.h"
+#include "../Codec/Codec.h"
+#include <fstream>
+#include <cstring>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace {
+	const unsigned int bytesPerPixel = 4;
+}
+
+/*******************************
+
+		   Codec sink
+
+*******************************/
+
+CodecSink::CodecSink(const std::string& fileName, const std::string& format) :
+	fileName(fileName), format(format), encoded(nullptr), width(0), height(0) {};
+
+CodecSink::CodecSink(std::vector<unsigned char>& encoded, const std::string& format) :
+	format(format), encoded(&encoded), width(0), height(0) {};
+
+/*Allocates space for the whole image.*/
+unsigned char* CodecSink::open(unsigned int w, unsigned int h) {
+	width = w;
+	height = h;
+	pixels.resize((size_t)w * h * bytesPerPixel);
+	return pixels.data();
+}
+
+/*Encodes image and frees memory.*/
+void CodecSink::close(void) {
+	if (encoded)
+		Codec::get(format).encode(*encoded, pixels.data(), width, height);
+	else
+		Codec::get(format).encodeFile(fileName, pixels.data(), width, height);
+	std::vector<unsigned char>().swap(pixels);
+}
+
+/*******************************
+
+		   Buffer sink
+
+*******************************/
+
+BufferSink::BufferSink(std::vector<unsigned char>& buffer) : buffer(buffer), width(0), height(0) {};
+
+/*Resizes caller's buffer to fit the image.*/
+unsigned char* BufferSink::open(unsigned int w, unsigned int h) {
+	width = w;
+	height = h;
+	buffer.resize((size_t)w * h * bytesPerPixel);
+	return buffer.data();
+}
+
+/*Getters.*/
+unsigned int BufferSink::getWidth(void) const { return width; }
+unsigned int BufferSink::getHeight(void) const { return height; }
+
+/*******************************
+
+		Memory mapped sink
+
+*******************************/
+
+MappedFileSink::MappedFileSink(const std::string& fileName, bool pam) : fileName(fileName), pam(pam) {};
+
+/*Creates file with its final size and maps it to memory.*/
+unsigned char* MappedFileSink::open(unsigned int w, unsigned int h) {
+	const std::string header = pam ?
+		"P7\nWIDTH " + std::to_string(w) + "\nHEIGHT " + std::to_string(h) + "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n" : "";
+	size_t size = header.length() + (size_t)w * h * bytesPerPixel;
+
+	/*Sets file size.*/
+	{
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		if (!file || !file.seekp(size - 1) || !file.put(0))
+			throw std::exception(("Failed to create file " + fileName + '.').c_str());
+	}
+
+	/*Maps file and writes header.*/
+	try {
+		boost::interprocess::file_mapping mapping(fileName.c_str(), boost::interprocess::read_write);
+		region.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_write));
+	}
+	catch (boost::interprocess::interprocess_exception&) {
+		throw std::exception(("Failed to map file " + fileName + '.').c_str());
+	}
+
+	unsigned char* data = (unsigned char*)region->get_address();
+	memcpy(data, header.data(), header.length());
+
+	return data + header.length();
+}
+
+/*Flushes mapped data to disk and unmaps file.*/
+void MappedFileSink::close(void) {
+	if (region) {
+		region->flush();
+		region.reset();
+	}
+}
+
+MappedFileSink::~MappedFileSink() {}
+
+/*******************************
+
+			Row sink
+
+*******************************/
+
+RowSink::RowSink(const rowCallback& callback) : callback(callback), width(0) {};
+
+/*Has no buffer, so pixels are received through write().*/
+unsigned char* RowSink::open(unsigned int w, unsigned int h) {
+	width = w;
+	return nullptr;
+}
+
+/*Calls callback for every given row.*/
+void RowSink::write(const unsigned char* rows, unsigned int first, unsigned int count) {
+	for (unsigned int i = 0; i < count; i++)
+		callback(rows + (size_t)i * width * bytesPerPixel, first + i, width);
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+namespace boost { namespace interprocess { class mapped_region; } }
+
+/*Byte offset of each channel in a 32 bit pixel.*/
+struct PixelLayout {
+	unsigned char red, green, blue, alpha;
+};
+
+/*Layout of pixels handed to sinks.*/
+const PixelLayout rgbaLayout = { 0, 1, 2, 3 };
+
+/*Destination for decompressed RGBA pixels.*/
+class PixelSink {
+public:
+	virtual ~PixelSink() {};
+
+	/*Called once image size is known. Sinks that own a suitable buffer
+	return it so pixels get decompressed straight into it. Otherwise, it
+	returns nullptr and pixels are handed over through write().*/
+	virtual unsigned char* open(unsigned int, unsigned int) = 0;
+
+	/*Receives 'count' rows starting at row 'first'.*/
+	virtual void write(const unsigned char*, unsigned int, unsigned int) {};
+
+	/*Called when image is complete.*/
+	virtual void close(void) {};
+};
+
+/*Encodes pixels with the codec of the given format,
+either to a file or to a caller owned buffer.*/
+class CodecSink : public PixelSink {
+public:
+	CodecSink(const std::string&, const std::string&);
+	CodecSink(std::vector<unsigned char>&, const std::string&);
+
+	unsigned char* open(unsigned int, unsigned int);
+	void close(void);
+private:
+	std::string fileName, format;
+	std::vector<unsigned char>* encoded;
+	std::vector<unsigned char> pixels;
+	unsigned int width, height;
+};
+
+/*Keeps pixels in a caller owned memory buffer.*/
+class BufferSink : public PixelSink {
+public:
+	BufferSink(std::vector<unsigned char>&);
+
+	unsigned char* open(unsigned int, unsigned int);
+
+	unsigned int getWidth(void) const;
+	unsigned int getHeight(void) const;
+private:
+	std::vector<unsigned char>& buffer;
+	unsigned int width, height;
+};
+
+/*Writes pixels to a memory mapped file, either as headerless
+raw RGBA data or as a PAM image.*/
+class MappedFileSink : public PixelSink {
+public:
+	MappedFileSink(const std::string&, bool = true);
+	~MappedFileSink();
+
+	unsigned char* open(unsigned int, unsigned int);
+	void close(void);
+private:
+	std::string fileName;
+	bool pam;
+	std::unique_ptr<boost::interprocess::mapped_region> region;
+};
+
+/*Hands every row to a caller supplied callback,
+which gets row data, row number and width in pixels.*/
+class RowSink : public PixelSink {
+public:
+	using rowCallback = std::function<void(const unsigned char*, unsigned int, unsigned int)>;
+
+	RowSink(const rowCallback&);
+
+	unsigned char* open(unsigned int, unsigned int);
+	void write(const unsigned char*, unsigned int, unsigned int);
+private:
+	rowCallback callback;
+	unsigned int width;
+};
@@ -1,5 +1,19 @@
 #include "QuadTree.h"
-#include "lodepng.h"
+#include "Codec/Codec.h"
+#include "PixelSink/PixelSink.h"
+#include "StatsPyramid/StatsPyramid.h"
+#include "TreeIndex/TreeIndex.h"
+#include "Estimator/Estimator.h"
+#include "Metrics/Metrics.h"
+#include "../Trace/Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 /*Constants to use throughout program. */
 /********************************************/
@@ -10,7 +24,31 @@ namespace {
 	const unsigned int maxDif = 3 * maxVal;
 	const unsigned int divide = 4;
 	const unsigned int bytesPerPixel = 4;
-	const char* imageFormat = "png";
+	const char* containerFormat = "png";
+	const char* defaultImageFormat = "png";
+	const char* stdStream = "-";
+
+	/*Separates output name from threshold in multi-threshold outputs.*/
+	const char tierSeparator = '_';
+
+	/*Tree index depth. Indexed cells cover at least 2^lodBlock pixels per side,
+	and smaller nodes are parsed instead. At most maxIndexDepth levels are
+	indexed, which is 4^10 cells, about 17 MB, for the lowest one.*/
+	const unsigned int lodBlock = 6;
+	const unsigned int maxIndexDepth = 10;
+
+	/*Threshold giving the k-th step of a threshold search. Range decisions
+	compare integer differences, from 0 to maxDif, so under RANGE these are
+	its only maxDif + 1 distinct trees. Variance decisions are continuous, so
+	steps are only a grid of them there.*/
+	double stepThreshold(unsigned int k) {
+		return k < maxDif ? (k + 0.5) / maxDif : 1;
+	}
+
+	/*Seconds since 'start', for stage stats.*/
+	double secondsSince(const std::chrono::steady_clock::time_point& start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
 }
 namespace treeData {
 	const enum : const unsigned char {
@@ -21,10 +59,12 @@ namespace treeData {
 }
 /********************************************/
 
-QuadTree::QuadTree() : inputFile(nullptr), outputFile(nullptr), height(0), width(0), threshold(0), realsize(0), index(0) {};
+QuadTree::QuadTree() : inputFile(nullptr), outputFile(nullptr), height(0), width(0), threshold(0), realsize(0), index(0), imageFormat(defaultImageFormat),
+criterion(SplitCriterion::RANGE) {};
 
 /*QuadTree constructor. Saves format.*/
-QuadTree::QuadTree(const std::string& format) : inputFile(nullptr), outputFile(nullptr), height(0), width(0), threshold(0), realsize(0), index(0)
+QuadTree::QuadTree(const std::string& format) : inputFile(nullptr), outputFile(nullptr), height(0), width(0), threshold(0), realsize(0), index(0), imageFormat(defaultImageFormat),
+criterion(SplitCriterion::RANGE)
 {
 	setFormat(format);
 }
@@ -37,6 +77,18 @@ void QuadTree::setFormat(const std::string& format) {
 	this->format = format.substr(pos + 1, format.length() - pos);
 }
 
+/*Sets image format for decompressed outputs. It must have a registered codec.*/
+void QuadTree::setImageFormat(const std::string& format) {
+	if (!Codec::exists(format)) {
+		const std::string errStr = "No codec available for format " + format + '.';
+		throw std::exception(errStr.c_str());
+	}
+	imageFormat = Codec::extension('.' + format);
+}
+
+/*Sets split criterion for compression.*/
+void QuadTree::setCriterion(SplitCriterion value) { criterion = value; }
+
 /*******************************
 
 		  Compression
@@ -45,41 +97,443 @@ void QuadTree::setFormat(const std::string& format) {
 
 /*Compresses image from input inputFile to output inputFile, with the given threshold. */
 void QuadTree::compressAndSave(const std::string& input, const std::string& output, const double threshold) {
+	/*Transforms filenames into correct ones.*/
+	const std::string realInput = parseImage(input);
+	const std::string realOutput = parse(output, format);
+
+	std::vector<unsigned char> data, compressed;
+
+	/*Reads, compresses and writes file.*/
+	Codec::readFile(realInput, data);
+	compressBuffer(data, Codec::extension(realInput), compressed, threshold);
+	Codec::writeFile(realOutput, compressed);
+}
+
+/*Compresses image from input inputFile at each given threshold. Each output is
+named after 'output' and its threshold, as given by tierName. Image is read,
+decoded and scanned only once.*/
+void QuadTree::compressAndSave(const std::string& input, const std::string& output, const std::vector<double>& thresholds) {
+	/*Transforms filenames into correct ones.*/
+	const std::string realInput = parseImage(input);
+	const std::string realOutput = parse(output, format);
+
+	if (realOutput == stdStream && thresholds.size() > 1)
+		throw std::exception("Several thresholds can't be written to a single stream.");
+
+	std::vector<unsigned char> data;
+	std::vector<std::vector<unsigned char>> compressed;
+
+	/*Reads and compresses file, and writes each output.*/
+	Codec::readFile(realInput, data);
+	compressThresholds(data, Codec::extension(realInput), thresholds, compressed);
+	for (unsigned int i = 0; i < thresholds.size(); i++)
+		Codec::writeFile(thresholds.size() > 1 ? tierName(realOutput, thresholds[i]) : realOutput, compressed[i]);
+}
+
+/*Compresses image from input inputFile to output inputFile aiming at the given
+target, as in compressTarget. Returns the threshold used.*/
+double QuadTree::compressAndSave(const std::string& input, const std::string& output, const TargetMode mode, const double target) {
+	/*Transforms filenames into correct ones.*/
+	const std::string realInput = parseImage(input);
+	const std::string realOutput = parse(output, format);
+
+	std::vector<unsigned char> data, compressed;
+
+	/*Reads, compresses and writes file.*/
+	Codec::readFile(realInput, data);
+	const double result = compressTarget(data, Codec::extension(realInput), compressed, mode, target);
+	Codec::writeFile(realOutput, compressed);
+	return result;
+}
+
+/*Compresses an encoded image held in memory. Image format is given by 'imgFormat'
+or, if it's empty, detected from data. Compressed file is saved to 'output'.*/
+void QuadTree::compressBuffer(const std::vector<unsigned char>& input, const std::string& imgFormat, std::vector<unsigned char>& output, const double threshold) {
 	if (threshold > 0 && threshold <= 1) {
-		/*Transforms filenames into correct ones.*/
-		const std::string realInput = parse(input, imageFormat);
-		const std::string realOutput = parse(output, format);
+		stats = CodecStats();
+		stats.calls = 1;
+		stats.bytesIn = input.size();
 
 		/*Sets threshold.*/
 		this->threshold = threshold * maxDif;
 
 		/*Decodes raw data.*/
-		decodeRaw(realInput);
-
-		/*Checks validity of data format.*/
-		checkData();
+		auto start = std::chrono::steady_clock::now();
+		{
+			TraceSpan span("decode image", "codec");
+			decodeRaw(input, imgFormat);
 
-		/*Saves space for additional tree data and compresses inputFile.*/
-		tree.assign(bytesPerPixel, treeData::filling);
-		compress(inputFile, width, height);
+			/*Checks validity of data format.*/
+			checkData();
+		}
+		stats.decodeTime = secondsSince(start);
+
+		/*Saves space for additional tree data and compresses inputFile.
+		Variance splits take its pixels, to build their statistics.*/
+		start = std::chrono::steady_clock::now();
+		{
+			TraceSpan span("build tree", "codec");
+			tree.assign(bytesPerPixel, treeData::filling);
+			if (criterion == SplitCriterion::VARIANCE) {
+				std::unique_ptr<unsigned char, freeDeleter> pixels(inputFile);
+				inputFile = nullptr;
+				compressVariance(std::move(pixels), threshold);
+			}
+			else
+				compress(inputFile, width, height);
+		}
+		stats.buildTime = secondsSince(start);
 
 		/*Encodes compressed inputFile.*/
-		encodeCompressed(realOutput);
+		start = std::chrono::steady_clock::now();
+		{
+			TraceSpan span("encode tree", "codec");
+			encodeCompressed(output);
+		}
+		stats.encodeTime = secondsSince(start);
 	}
 	else
 		throw std::exception("Threshold must be a non-negative value higher than 0 and up to 1.");
 }
 
-/*Decodes raw data from inputFile.*/
-void QuadTree::decodeRaw(const std::string& fileName) {
-	/*Decodes inputFile and checks for errors.*/
-	int error = lodepng_decode32_file(&inputFile, &width, &height, fileName.c_str());
-	if (error) {
-		std::string errStr = "Failed to decode file. Lodepng error: " + (std::string) lodepng_error_text(error);
+/*Decompresses 'compressed' and compares it with 'original', the encoded image
+it was compressed from, whose format is given as in compressBuffer. Stats are
+the last call's, with the result's SSIM added, so batches can average it.*/
+const Quality QuadTree::verify(const std::vector<unsigned char>& original, const std::string& imgFormat, const std::vector<unsigned char>& compressed) {
+	TraceSpan span("verify", "codec");
+	const CodecStats last = stats;
+	std::vector<unsigned char> decompressed;
+	BufferSink sink(decompressed);
+
+	decompressBuffer(compressed, sink);
+	stats = last;
+
+	decodeRaw(original, imgFormat);
+	std::unique_ptr<unsigned char, freeDeleter> pixels(inputFile);
+	inputFile = nullptr;
+	if (width / bytesPerPixel != sink.getWidth() || height != sink.getHeight())
+		throw std::exception("Compressed image doesn't match the original's size.");
+
+	const Quality result = Metrics::compare(pixels.get(), decompressed.data(), sink.getWidth(), sink.getHeight());
+	stats.ssim += result.ssim;
+	stats.verified++;
+	return result;
+}
+
+/*First compression stage. Decodes job's encoded image to its pixels.*/
+void QuadTree::decodeStage(CompressionJob& job) {
+	TraceSpan span("decode image", "codec");
+	const auto start = std::chrono::steady_clock::now();
+	job.stats = CodecStats();
+	job.stats.calls = 1;
+	job.stats.bytesIn = job.data.size();
+
+	decodeRaw(job.data, job.format);
+
+	/*Hands pixels to job, so they're freed even if data is invalid.*/
+	job.pixels.reset(inputFile);
+	inputFile = nullptr;
+
+	/*Checks validity of data format.*/
+	checkData();
+
+	job.width = width / bytesPerPixel;
+	job.height = height;
+	std::vector<unsigned char>().swap(job.data);
+	job.stats.decodeTime = secondsSince(start);
+}
+
+/*Second compression stage. Builds tree from job's pixels.*/
+void QuadTree::buildStage(CompressionJob& job) {
+	if (job.threshold <= 0 || job.threshold > 1)
+		throw std::exception("Threshold must be a non-negative value higher than 0 and up to 1.");
+
+	/*Sets threshold and image info.*/
+	TraceSpan span("build tree", "codec");
+	const auto start = std::chrono::steady_clock::now();
+	threshold = job.threshold * maxDif;
+	width = job.width * bytesPerPixel;
+	height = job.height;
+	stats = job.stats;
+
+	/*Saves space for additional tree data and compresses pixels.*/
+	tree.assign(bytesPerPixel, treeData::filling);
+	if (job.criterion == SplitCriterion::VARIANCE)
+		compressVariance(std::move(job.pixels), job.threshold);
+	else
+		compress(job.pixels.get(), width, height);
+	stats.peakScratch = std::max(stats.peakScratch, (unsigned long long)width * height + tree.capacity());
+
+	/*Pixels are not needed anymore.*/
+	job.pixels.reset();
+	job.tree.swap(tree);
+
+	stats.buildTime = secondsSince(start);
+	job.stats = stats;
+}
+
+/*Third compression stage. Encodes job's tree to its data.*/
+void QuadTree::encodeStage(CompressionJob& job) {
+	TraceSpan span("encode tree", "codec");
+	const auto start = std::chrono::steady_clock::now();
+	tree.swap(job.tree);
+	height = job.height;
+	stats = job.stats;
+
+	encodeCompressed(job.data);
+
+	stats.encodeTime = secondsSince(start);
+	job.stats = stats;
+}
+
+/*Decodes an encoded image and builds its node statistics, keeping at most
+'maxLevels' levels of them. Image format is given by 'imgFormat' or, if it's
+empty, detected from data. Statistics keep the decoded pixels.*/
+void QuadTree::buildStats(const std::vector<unsigned char>& input, const std::string& imgFormat, StatsPyramid& stats, unsigned int maxLevels) {
+	decodeRaw(input, imgFormat);
+
+	/*Checks validity of data format.*/
+	checkData();
+
+	/*Pyramid takes the pixels. They leave inputFile first, so they're freed
+	once if building throws.*/
+	std::unique_ptr<unsigned char, freeDeleter> pixels(inputFile);
+	inputFile = nullptr;
+	stats.build(std::move(pixels), height, maxLevels);
+	stats.setCriterion(criterion);
+}
+
+/*Compresses an image from its node statistics, with the given threshold and
+their criterion. Only split decisions are made, as no pixel is read except for single pixel
+leaves. Output matches compressBuffer's for the same image and threshold.*/
+void QuadTree::compressStats(const StatsPyramid& pyramid, std::vector<unsigned char>& output, const double threshold) {
+	if (threshold <= 0 || threshold > 1)
+		throw std::exception("Threshold must be a non-negative value higher than 0 and up to 1.");
+	if (pyramid.isEmpty())
+		throw std::exception("File is empty.");
+
+	stats = CodecStats();
+	stats.calls = 1;
+
+	/*Sets threshold and image info.*/
+	this->threshold = threshold * maxDif;
+	width = pyramid.getSide() * bytesPerPixel;
+	height = pyramid.getSide();
+
+	/*Saves space for additional tree data and compresses statistics.*/
+	auto start = std::chrono::steady_clock::now();
+	{
+		TraceSpan span("build tree", "codec");
+		tree.assign(bytesPerPixel, treeData::filling);
+		compress(pyramid, threshold, 0, 0, 0);
+	}
+	stats.buildTime = secondsSince(start);
+
+	/*Encodes tree.*/
+	start = std::chrono::steady_clock::now();
+	{
+		TraceSpan span("encode tree", "codec");
+		encodeCompressed(output);
+	}
+	stats.encodeTime = secondsSince(start);
+}
+
+/*Decodes an encoded image held in memory once and compresses it at each given
+threshold, saving each result to the matching position of 'outputs'. Only the
+split decisions are repeated for each threshold. Stats add every threshold's.*/
+void QuadTree::compressThresholds(const std::vector<unsigned char>& input, const std::string& imgFormat,
+	const std::vector<double>& thresholds, std::vector<std::vector<unsigned char>>& outputs) {
+	for (double value : thresholds) {
+		if (value <= 0 || value > 1)
+			throw std::exception("Threshold must be a non-negative value higher than 0 and up to 1.");
+	}
+
+	CodecStats total;
+	StatsPyramid pyramid;
+	total.calls = 1;
+	total.bytesIn = input.size();
+
+	/*Decodes image and builds its statistics.*/
+	auto start = std::chrono::steady_clock::now();
+	{
+		TraceSpan span("decode image", "codec");
+		buildStats(input, imgFormat, pyramid);
+	}
+	total.decodeTime = secondsSince(start);
+	total.pixelsScanned = (unsigned long long)pyramid.getSide() * pyramid.getSide();
+
+	outputs.assign(thresholds.size(), std::vector<unsigned char>());
+	for (unsigned int i = 0; i < thresholds.size(); i++) {
+		compressStats(pyramid, outputs[i], thresholds[i]);
+
+		stats.calls = 0;
+		stats.bytesIn = 0;
+		total.add(stats);
+	}
+	stats = total;
+}
+
+/*Decodes an encoded image held in memory once and estimates the result of
+compressing it at each given threshold, without compressing it. See Estimator.
+First estimate's time counts downsampling too.*/
+const std::vector<Estimate> QuadTree::estimate(const std::vector<unsigned char>& input, const std::string& imgFormat, const std::vector<double>& thresholds) {
+	for (double value : thresholds) {
+		if (value <= 0 || value > 1)
+			throw std::exception("Threshold must be a non-negative value higher than 0 and up to 1.");
+	}
+
+	{
+		TraceSpan span("decode image", "codec");
+		decodeRaw(input, imgFormat);
+
+		/*Checks validity of data format.*/
+		checkData();
+	}
+
+	TraceSpan span("estimate", "codec");
+	const auto start = std::chrono::steady_clock::now();
+	const Estimator estimator(inputFile, height, criterion);
+	const double pooling = secondsSince(start);
+
+	std::vector<Estimate> result;
+	for (double value : thresholds)
+		result.push_back(estimator.estimate(value));
+	if (result.size())
+		result.front().seconds += pooling;
+
+	free(inputFile);
+	inputFile = nullptr;
+	return result;
+}
+
+/*Compresses an encoded image held in memory aiming at 'target'. With SIZE, it's
+the largest output size in bytes, and the lowest threshold that fits is used.
+With PSNR, it's the lowest PSNR in dB, and the highest threshold that reaches
+it is used. With THRESHOLD, it's the threshold itself. Image is decoded and
+scanned once, and each threshold tried only walks its statistics.
+Returns the threshold used.*/
+double QuadTree::compressTarget(const std::vector<unsigned char>& input, const std::string& imgFormat,
+	std::vector<unsigned char>& output, const TargetMode mode, const double target) {
+	if (mode == TargetMode::THRESHOLD) {
+		compressBuffer(input, imgFormat, output, target);
+		return target;
+	}
+
+	CodecStats total;
+	StatsPyramid pyramid;
+	total.calls = 1;
+	total.bytesIn = input.size();
+
+	/*Decodes image and builds its statistics.*/
+	const auto start = std::chrono::steady_clock::now();
+	{
+		TraceSpan span("decode image", "codec");
+		buildStats(input, imgFormat, pyramid);
+	}
+	total.decodeTime = secondsSince(start);
+	total.pixelsScanned = (unsigned long long)pyramid.getSide() * pyramid.getSide();
+
+	const double result = mode == TargetMode::SIZE ? searchSize(pyramid, target, output, total) : searchPSNR(pyramid, target, output, total);
+	total.bytesOut = output.size();
+	stats = total;
+	return result;
+}
+
+/*Binary searches the lowest threshold whose output fits in 'maxBytes', saving
+that output. Each probe compresses and encodes, as output size is only known
+after encoding. Probe stats are added to 'total'.*/
+double QuadTree::searchSize(const StatsPyramid& pyramid, const double maxBytes, std::vector<unsigned char>& output, CodecStats& total) {
+	TraceSpan span("search size", "codec");
+	std::vector<unsigned char> probe;
+	unsigned int low = 0, high = maxDif;
+
+	/*Adds stats of last probe and checks if it fits.*/
+	const auto fits = [this, &pyramid, &probe, &total, maxBytes](unsigned int k) {
+		compressStats(pyramid, probe, stepThreshold(k));
+		stats.calls = 0;
+		total.add(stats);
+		return probe.size() <= maxBytes;
+	};
+
+	/*Coarsest tree must fit.*/
+	if (!fits(high)) {
+		const std::string errStr = "Image can't be compressed to " + std::to_string((unsigned long long)maxBytes) + " bytes. Smallest output is "
+			+ std::to_string(probe.size()) + " bytes.";
 		throw std::exception(errStr.c_str());
 	}
-	if (!inputFile)
-		throw std::exception("Memory allocation for file failed.");
+	output.swap(probe);
+
+	/*Output size decreases as threshold grows.*/
+	while (low < high) {
+		const unsigned int mid = (low + high) / 2;
+		if (fits(mid)) {
+			high = mid;
+			output.swap(probe);
+		}
+		else
+			low = mid + 1;
+	}
+	return stepThreshold(high);
+}
+
+/*Binary searches the highest threshold whose PSNR is at least 'minPSNR', and
+compresses at it. Probes only walk statistics, so only the result is encoded.*/
+double QuadTree::searchPSNR(const StatsPyramid& pyramid, const double minPSNR, std::vector<unsigned char>& output, CodecStats& total) {
+	unsigned int low = 0, high = maxDif;
+	{
+		TraceSpan span("search PSNR", "codec");
+		const auto start = std::chrono::steady_clock::now();
+
+		/*PSNR decreases as threshold grows. Under RANGE, lowest threshold only
+		merges blocks of a single color, so it's lossless. Under VARIANCE, it
+		still merges large blocks with a few pixels off, so it's checked below.*/
+		while (low < high) {
+			const unsigned int mid = (low + high + 1) / 2;
+			if (pyramid.getPSNR(stepThreshold(mid)) >= minPSNR)
+				low = mid;
+			else
+				high = mid - 1;
+		}
+		total.buildTime += secondsSince(start);
+	}
+
+	/*Finest tree must reach the target.*/
+	const double best = pyramid.getPSNR(stepThreshold(low));
+	if (best < minPSNR) {
+		std::ostringstream errStr;
+		errStr << "Image can't be compressed to " << minPSNR << " dB. Highest PSNR is " << best << " dB.";
+		throw std::exception(errStr.str().c_str());
+	}
+
+	compressStats(pyramid, output, stepThreshold(low));
+	stats.calls = 0;
+	total.add(stats);
+	return stepThreshold(low);
+}
+
+/*Returns name of the output compressed at 'threshold' among several, which is
+'output' with the threshold appended before its format. For example,
+"image.EDA" at 0.1 is "image_0.1.EDA".*/
+const std::string QuadTree::tierName(const std::string& output, const double threshold) const {
+	const std::string realOutput = parse(output, format);
+	std::ostringstream name;
+
+	name << realOutput.substr(0, realOutput.length() - format.length() - 1) << tierSeparator << threshold << '.' << format;
+	return name.str();
+}
+
+/*Decodes raw data from inputFile.*/
+void QuadTree::decodeRaw(const std::vector<unsigned char>& data, const std::string& imgFormat) {
+	/*Frees data left by a previous failed compression.*/
+	if (inputFile) {
+		free(inputFile);
+		inputFile = nullptr;
+	}
+
+	/*Decodes inputFile with the codec matching its format. Streams
+	and files without extension are detected by their magic bytes.*/
+	const Codec& codec = imgFormat.length() ? Codec::get(imgFormat) : Codec::detect(data.data(), data.size());
+	codec.decode(data.data(), data.size(), &inputFile, &width, &height);
 
 	/*Sets real width.*/
 	width *= bytesPerPixel;
@@ -113,8 +567,10 @@ void QuadTree::checkData(void) const {
 	}
 }
 
-/*Recursively compresses data to tree.*/
-void QuadTree::compress(const unsigned char* start, unsigned int W, unsigned int H) {
+/*Recursively compresses data to tree. 'depth' is the node's level, with root at 0.*/
+void QuadTree::compress(const unsigned char* start, unsigned int W, unsigned int H, unsigned int depth) {
+	stats.nodes++;
+
 	/*If it's only one pixel...*/
 	if (W * H == bytesPerPixel) {
 		/*Loads noChildren to tree and pushes RGB code. It's a leaf.*/
@@ -127,6 +583,10 @@ void QuadTree::compress(const unsigned char* start, unsigned int W, unsigned int
 		/*Loads noChildren to tree and pushes mean RGB code. It's a leaf.*/
 		tree.push_back(treeData::noChildren);
 		tree.insert(tree.end(), mean.begin(), mean.end());
+
+		/*Adds the error of filling the block with its mean, as decompression will.*/
+		const unsigned char rgb[bytesPerPixel - 1] = { (unsigned char)mean[0], (unsigned char)mean[1], (unsigned char)mean[2] };
+		stats.squaredError += Metrics::fillError(start, width, W / bytesPerPixel, H, rgb);
 	}
 
 	/*Otherwise...*/
@@ -135,12 +595,59 @@ void QuadTree::compress(const unsigned char* start, unsigned int W, unsigned int
 		It's an inner node.*/
 		tree.push_back(treeData::hasChildren);
 		for (int i = 0; i < divide; i++)
-			compress(getNewPosition(start, W, H, i), W / 2, H / 2);
+			compress(getNewPosition(start, W, H, i), W / 2, H / 2, depth + 1);
+		return;
 	}
+
+	stats.leaves++;
+	stats.maxDepth = std::max(stats.maxDepth, depth);
+	stats.samples += (unsigned long long)W / bytesPerPixel * H * (bytesPerPixel - 1);
+}
+
+/*Recursively compresses node statistics to tree at the given threshold, from 0 to 1.
+Node is given by its level, which is also its depth, row and column, as in StatsPyramid.*/
+void QuadTree::compress(const StatsPyramid& pyramid, const double threshold, unsigned int level, unsigned int row, unsigned int col) {
+	stats.nodes++;
+
+	/*If it's a single pixel or its RGB formula is less than threshold, it's
+	a leaf. Loads noChildren to tree and pushes its RGB code.*/
+	if (pyramid.isLeaf(level, row, col, threshold)) {
+		unsigned char rgb[bytesPerPixel - 1];
+		pyramid.getColor(level, row, col, rgb);
+
+		tree.push_back(treeData::noChildren);
+		tree.insert(tree.end(), rgb, rgb + bytesPerPixel - 1);
+		stats.leaves++;
+		stats.maxDepth = std::max(stats.maxDepth, level);
+		stats.squaredError += pyramid.leafError(level, row, col);
+		stats.samples += ((unsigned long long)pyramid.getSide() >> level) * (pyramid.getSide() >> level) * (bytesPerPixel - 1);
+	}
+
+	/*Otherwise, pushes hasChildren and compresses its 'divide' children. It's an inner node.*/
+	else {
+		tree.push_back(treeData::hasChildren);
+		for (unsigned int i = 0; i < divide; i++)
+			compress(pyramid, threshold, level + 1, 2 * row + i / 2, 2 * col + i % 2);
+	}
+}
+
+/*Compresses pixels of a square image with the variance criterion, at the
+given threshold, from 0 to 1. Pixels are read once, to build node statistics,
+and then each split is decided from them in constant time.*/
+void QuadTree::compressVariance(std::unique_ptr<unsigned char, freeDeleter> pixels, const double threshold) {
+	StatsPyramid pyramid;
+	pyramid.build(std::move(pixels), height);
+	pyramid.setCriterion(SplitCriterion::VARIANCE);
+	stats.pixelsScanned += (unsigned long long)height * height;
+
+	/*Pyramid has about a third of a node per pixel.*/
+	stats.peakScratch = std::max(stats.peakScratch, (unsigned long long)width * height + (unsigned long long)height * height / 3 * sizeof(StatsPyramid::Node));
+
+	compress(pyramid, threshold, 0, 0, 0);
 }
 
-/*Encodes compressed data to inputFile.*/
-void QuadTree::encodeCompressed(const std::string& fileName) {
+/*Encodes compressed data to output buffer.*/
+void QuadTree::encodeCompressed(std::vector<unsigned char>& output) {
 	/*Generates size that is a multiple of bytesPerPixel.*/
 	unsigned int size = tree.size();
 	while ((++size) % bytesPerPixel);
@@ -151,12 +658,11 @@ void QuadTree::encodeCompressed(const std::string& fileName) {
 	unsigned int offset = tree.size() - size + bytesPerPixel;
 	tree[offset] = (unsigned char)log2(height);
 
-	/*Encodes tree in inputFile and checks for errors.*/
-	int error = lodepng_encode32_file(fileName.c_str(), tree.data() + offset, size / bytesPerPixel, 1);
-	if (error) {
-		std::string errStr = "Failed to encode compressed file. Lodepng error: " + (std::string)lodepng_error_text(error);
-		throw std::exception(errStr.c_str());
-	}
+	/*Encodes tree, from offset to its end.*/
+	Codec::get(containerFormat).encode(output, tree.data() + offset, (tree.size() - offset) / bytesPerPixel, 1);
+	stats.bytesOut = output.size();
+	stats.peakScratch = std::max(stats.peakScratch, (inputFile ? (unsigned long long)width * height : 0) + tree.capacity() + output.size());
+
 	/*Frees memory.*/
 	if (inputFile) {
 		free(inputFile);
@@ -164,19 +670,22 @@ void QuadTree::encodeCompressed(const std::string& fileName) {
 	}
 }
 
-/*Checks if vector's RGB formula is less than threshold.
+/*Checks if vector's RGB formula, the range criterion, is less than threshold.
 If it is, then it returns true and saves mean values to 'mean'.
 Otherwise, it returns false.*/
 bool QuadTree::lessThanThreshold(const unsigned char* start, unsigned int W, unsigned int H) {
 	/*Checks for correct shape.*/
 	if (W * H < bytesPerPixel)
 		throw std::exception("Invalid input. Expected at least one pixel.");
+	stats.pixelsScanned += (unsigned long long)W / bytesPerPixel * H;
 
 	/*Creates variables to use in function. Mexrgb saves max values of rgb and
-	minrgb saves min values of rgb.*/
+	minrgb saves min values of rgb. Sums are integers, so mean is the same one
+	StatsPyramid gives.*/
 	mean.assign(bytesPerPixel - 1, 0);
 	std::vector<unsigned int> maxrgb(bytesPerPixel - 1, minVal);
 	std::vector<unsigned int> minrgb(bytesPerPixel - 1, maxVal);
+	std::vector<unsigned long long> sum(bytesPerPixel - 1, 0);
 	int count = -1;
 
 	unsigned int value;
@@ -195,12 +704,12 @@ bool QuadTree::lessThanThreshold(const unsigned char* start, unsigned int W, uns
 					maxrgb[count] = value;
 
 				/*If value is lower than corresponding value
-				in maxrgb, it changes it.*/
-				else if (value < minrgb[count])
+				in minrgb, it changes it. A value can be both.*/
+				if (value < minrgb[count])
 					minrgb[count] = value;
 
-				/*Updates mean.*/
-				mean[count] += value * bytesPerPixel / (float)(W * H);
+				/*Updates sum.*/
+				sum[count] += value;
 			}
 			/*Resets count when it reached bytesPerPixel - 1.*/
 			else
@@ -208,6 +717,10 @@ bool QuadTree::lessThanThreshold(const unsigned char* start, unsigned int W, uns
 		}
 	}
 
+	/*Gets mean from sum.*/
+	for (unsigned int i = 0; i < bytesPerPixel - 1; i++)
+		mean[i] = (float)(sum[i] * bytesPerPixel / (W * H));
+
 	value = 0;
 	/*Applies formula.*/
 	for (unsigned int i = 0; i < bytesPerPixel - 1; i++)
@@ -243,36 +756,381 @@ const unsigned char* QuadTree::getNewPosition(const unsigned char* start, unsign
 
 /*Decompresses the input inputFile and saves it to output inputFile. */
 void QuadTree::decompressAndSave(const std::string& input, const std::string& output) {
-	const std::string realInput = parse(input, format);
 	const std::string realOutput = parse(output, imageFormat);
 
+	/*Encodes decompressed pixels with the codec of the chosen image format.*/
+	CodecSink sink(realOutput, imageFormat);
+	decompressAndSave(input, sink);
+}
+
+/*Decompresses the input inputFile and hands its pixels to the given sink. */
+void QuadTree::decompressAndSave(const std::string& input, PixelSink& sink) {
+	const std::string realInput = parse(input, format);
+
+	std::vector<unsigned char> data;
+	Codec::readFile(realInput, data);
+
+	decompressBuffer(data, sink);
+}
+
+/*Decompresses a compressed file held in memory and hands its pixels to the given sink. */
+void QuadTree::decompressBuffer(const std::vector<unsigned char>& input, PixelSink& sink) {
+	stats = CodecStats();
+	stats.calls = 1;
+	stats.bytesIn = input.size();
+
 	/*Decodes compressed inputFile.*/
-	decodeCompressed(realInput);
+	auto start = std::chrono::steady_clock::now();
+	{
+		TraceSpan span("decode tree", "codec");
+		decodeCompressed(input);
+	}
+	stats.decodeTime = secondsSince(start);
 
-	/*Decompresses inputFile.*/
-	unsigned char* substitute = inputFile;
-	decompress(&substitute);
+	/*Decompresses straight into the sink's buffer if it has one.
+	Otherwise, it allocates space for decompressed file. Either can fail,
+	so inputFile is returned to its start and freed if they do.*/
+	unsigned int size = static_cast<unsigned int> (sqrt(realsize / bytesPerPixel));
+	unsigned char* target = nullptr;
+	try {
+		target = sink.open(size, size);
+		outputFile = target ? target : (unsigned char*)malloc(realsize * sizeof(unsigned char));
+		if (!outputFile)
+			throw std::exception("Failed to allocate memory.");
+
+		/*Decompresses inputFile.*/
+		start = std::chrono::steady_clock::now();
+		TraceSpan span("walk tree", "codec");
+		unsigned char* substitute = inputFile;
+		decompress(&substitute);
+	}
+	catch (...) {
+		absPosit.clear();
+		freeDecompressed(!target);
+		throw;
+	}
+	stats.buildTime = secondsSince(start);
+	stats.bytesOut = realsize;
+	stats.peakScratch = (unsigned long long)width * height + realsize + absPosit.capacity() * sizeof(unsigned int);
 
 	/*Resets absolute position vector.*/
 	absPosit.clear();
 
-	/*Encodes raw data inputFile.*/
-	encodeRaw(realOutput);
+	/*Hands raw data to sink.*/
+	start = std::chrono::steady_clock::now();
+	{
+		TraceSpan span("encode image", "codec");
+		encodeRaw(sink, !target);
+	}
+	stats.encodeTime = secondsSince(start);
 }
 
-/*Decodes compressed data from inputFile. */
-void QuadTree::decodeCompressed(const std::string& fileName) {
-	//unsigned char* img;
+/*Decompresses a compressed file held in memory at a side of at most 'maxSide'
+pixels, and hands its pixels to the given sink. The whole tree is still decoded
+and walked, as subtrees can only be skipped by parsing them, but only its top is
+filled. Output memory and filling are those of the small image, not the original.*/
+void QuadTree::decompressShallow(const std::vector<unsigned char>& input, unsigned int maxSide, PixelSink& sink) {
+	/*Decodes compressed inputFile.*/
+	decodeCompressed(input);
 
-	/*Decodes data and checks for errors.*/
-	int error = lodepng_decode32_file(&inputFile, &width, &height, fileName.c_str());
-	if (error) {
-		std::string errStr = "Failed to decode compressed file. Lodepng error: " + (std::string)lodepng_error_text(error);
-		throw std::exception(errStr.c_str());
+	/*Output is the original image if it's small enough. Otherwise,
+	it's the largest power of 2 that fits in maxSide.*/
+	unsigned int size = static_cast<unsigned int> (sqrt(realsize / bytesPerPixel));
+	while (size > 1 && size > maxSide)
+		size /= 2;
+	realsize = size * size * bytesPerPixel;
+
+	/*Output is opened as in decompressBuffer, so inputFile is freed if it fails.*/
+	unsigned char* target = nullptr;
+	try {
+		target = sink.open(size, size);
+		outputFile = target ? target : (unsigned char*)malloc(realsize * sizeof(unsigned char));
+		if (!outputFile)
+			throw std::exception("Failed to allocate memory.");
+
+		/*Decompresses top of inputFile.*/
+		const unsigned char* substitute = inputFile;
+		decompressShallow(&substitute, inputFile - index + (size_t)width * height, 0, 0, size, size);
+	}
+	catch (...) {
+		freeDecompressed(!target);
+		throw;
+	}
+
+	/*Hands raw data to sink.*/
+	encodeRaw(sink, !target);
+}
+
+/*Decompresses the node at 'ptr', which covers a square of side 'size'
+output pixels starting at (row, col), into an output of side 'side'.*/
+void QuadTree::decompressShallow(const unsigned char** ptr, const unsigned char* end, unsigned int row, unsigned int col, unsigned int size, unsigned int side) {
+	unsigned char rgb[bytesPerPixel - 1];
+
+	if (*ptr >= end)
+		throw std::exception("Decompress got an invalid input.");
+
+	/*If it found a leaf, or a subtree covering a single output pixel...*/
+	if (**ptr == treeData::noChildren || (**ptr == treeData::hasChildren && size == 1)) {
+		double color[bytesPerPixel - 1] = {};
+		averageSubtree(ptr, end, 1, color);
+		for (unsigned int i = 0; i < bytesPerPixel - 1; i++)
+			rgb[i] = (unsigned char)color[i];
+
+		/*Fills its square.*/
+		for (unsigned int i = row; i < row + size; i++) {
+			for (unsigned int j = col; j < col + size; j++) {
+				unsigned char* pixel = outputFile + ((size_t)i * side + j) * bytesPerPixel;
+				std::copy(rgb, rgb + bytesPerPixel - 1, pixel);
+				pixel[bytesPerPixel - 1] = alpha;
+			}
+		}
+	}
+
+	/*If it found an inner node, decompresses each one of its children.*/
+	else if (**ptr == treeData::hasChildren) {
+		(*ptr)++;
+		for (unsigned int i = 0; i < divide; i++)
+			decompressShallow(ptr, end, row + (i / 2) * size / 2, col + (i % 2) * size / 2, size / 2, side);
+	}
+	else
+		throw std::exception("Decompress got an invalid input.");
+}
+
+/*Adds the color of the subtree at 'ptr' to 'rgb', weighted by 'weight',
+and moves 'ptr' past it. Each child has a quarter of its parent's weight.
+Throws if the subtree runs past 'end'.*/
+void QuadTree::averageSubtree(const unsigned char** ptr, const unsigned char* end, double weight, double* rgb) const {
+	if (*ptr >= end)
+		throw std::exception("Decompress got an invalid input.");
+
+	if (**ptr == treeData::noChildren) {
+		if (*ptr + bytesPerPixel > end)
+			throw std::exception("Decompress got an invalid input.");
+		(*ptr)++;
+		for (unsigned int i = 0; i < bytesPerPixel - 1; i++)
+			rgb[i] += weight * (*ptr)[i];
+		(*ptr) += bytesPerPixel - 1;
+	}
+	else if (**ptr == treeData::hasChildren) {
+		(*ptr)++;
+		for (unsigned int i = 0; i < divide; i++)
+			averageSubtree(ptr, end, weight / divide, rgb);
+	}
+	else
+		throw std::exception("Decompress got an invalid input.");
+}
+
+/*Output of decompressRegion. Output pixel (i, j) shows the image pixel
+at (x + (j + 0.5) / scale, y + (i + 0.5) / scale).*/
+struct QuadTree::Region {
+	double x, y, scale;
+	unsigned char* out;
+	unsigned int width, height;
+	int pitch;
+	PixelLayout layout;
+
+	/*Gets the output pixels covered by a node. Returns false if there are none.*/
+	bool span(unsigned int side, unsigned int level, unsigned int row, unsigned int col,
+		unsigned int& i0, unsigned int& i1, unsigned int& j0, unsigned int& j1) const {
+		const double size = side >> level;
+		const auto clamp = [](double value, unsigned int max) {
+			return (unsigned int)std::min(std::max(std::ceil(value - 0.5), 0.0), (double)max); };
+
+		j0 = clamp((col * size - x) * scale, width);
+		j1 = clamp(((col + 1) * size - x) * scale, width);
+		i0 = clamp((row * size - y) * scale, height);
+		i1 = clamp(((row + 1) * size - y) * scale, height);
+		return j0 < j1 && i0 < i1;
+	}
+
+	/*Fills output pixels with the given color. Each row is filled with a
+	copy of its first pixel.*/
+	void fill(unsigned int i0, unsigned int i1, unsigned int j0, unsigned int j1, const unsigned char* rgb) const {
+		unsigned char pixel[bytesPerPixel];
+		pixel[layout.red] = rgb[0];
+		pixel[layout.green] = rgb[1];
+		pixel[layout.blue] = rgb[2];
+		pixel[layout.alpha] = alpha;
+
+		uint32_t value;
+		memcpy(&value, pixel, bytesPerPixel);
+		for (unsigned int i = i0; i < i1; i++) {
+			uint32_t* row = reinterpret_cast<uint32_t*>(out + (ptrdiff_t)i * pitch) + j0;
+			std::fill(row, row + (j1 - j0), value);
+		}
+	}
+};
+
+/*Decodes a compressed file held in memory and indexes its tree.
+Index keeps the decoded tree.*/
+void QuadTree::indexCompressed(const std::vector<unsigned char>& input, TreeIndex& treeIndex) {
+	/*Decodes compressed inputFile.*/
+	decodeCompressed(input);
+
+	/*Hands decoded data to index.*/
+	const unsigned char* end = inputFile - index + (size_t)width * height;
+	treeIndex.data.reset(inputFile - index);
+	treeIndex.tree = inputFile;
+	treeIndex.size = end - inputFile;
+	inputFile = nullptr;
+	index = 0;
+
+	treeIndex.side = static_cast<unsigned int> (sqrt(realsize / bytesPerPixel));
+	for (treeIndex.depth = 0; (1u << treeIndex.depth) < treeIndex.side; treeIndex.depth++) {};
+	treeIndex.indexDepth = treeIndex.depth > lodBlock ? std::min(treeIndex.depth - lodBlock, maxIndexDepth) : 0;
+
+	treeIndex.levels.assign(treeIndex.indexDepth + 1, std::vector<TreeIndex::Cell>());
+	for (unsigned int level = 0; level <= treeIndex.indexDepth; level++)
+		treeIndex.levels[level].resize((size_t)1 << (2 * level));
+
+	/*Walks the whole tree once.*/
+	const unsigned char* ptr = treeIndex.tree;
+	double rgb[bytesPerPixel - 1];
+	try {
+		indexNode(treeIndex, &ptr, end, 0, 0, 0, rgb);
+	}
+	catch (...) {
+		treeIndex.levels.clear();
+		treeIndex.data.reset();
+		treeIndex.tree = nullptr;
+		treeIndex.size = 0;
+		treeIndex.side = 0;
+		throw;
+	}
+}
+
+/*Indexes the node at 'ptr' and moves 'ptr' past its subtree.
+Saves the node's mean color to 'rgb'.*/
+void QuadTree::indexNode(TreeIndex& treeIndex, const unsigned char** ptr, const unsigned char* end, unsigned int level, unsigned int row, unsigned int col, double* rgb) const {
+	if (*ptr >= end || level > treeIndex.depth)
+		throw std::exception("Decompress got an invalid input.");
+
+	TreeIndex::Cell cell;
+	cell.offset = *ptr - treeIndex.tree;
+
+	/*If it found a leaf, it fills every cell it covers.*/
+	if (**ptr == treeData::noChildren) {
+		if (*ptr + bytesPerPixel > end)
+			throw std::exception("Decompress got an invalid input.");
+
+		cell.leaf = true;
+		for (unsigned int i = 0; i < bytesPerPixel - 1; i++)
+			rgb[i] = cell.rgb[i] = (*ptr)[i + 1];
+
+		for (unsigned int l = level; l <= treeIndex.indexDepth; l++) {
+			const unsigned int span = 1 << (l - level);
+			for (unsigned int i = 0; i < span; i++) {
+				TreeIndex::Cell* first = &treeIndex.levels[l][(((size_t)row * span + i) << l) + col * span];
+				std::fill(first, first + span, cell);
+			}
+		}
+		(*ptr) += bytesPerPixel;
+	}
+
+	/*If it found an inner node, its mean is the mean of its children.*/
+	else if (**ptr == treeData::hasChildren) {
+		double childRgb[bytesPerPixel - 1];
+
+		(*ptr)++;
+		std::fill(rgb, rgb + bytesPerPixel - 1, 0.0);
+		for (unsigned int i = 0; i < divide; i++) {
+			indexNode(treeIndex, ptr, end, level + 1, 2 * row + i / 2, 2 * col + i % 2, childRgb);
+			for (unsigned int c = 0; c < bytesPerPixel - 1; c++)
+				rgb[c] += childRgb[c] / divide;
+		}
+
+		if (level <= treeIndex.indexDepth) {
+			cell.leaf = false;
+			for (unsigned int i = 0; i < bytesPerPixel - 1; i++)
+				cell.rgb[i] = (unsigned char)rgb[i];
+			treeIndex.levels[level][((size_t)row << level) + col] = cell;
+		}
+	}
+	else
+		throw std::exception("Decompress got an invalid input.");
+}
+
+/*Decompresses the region of the image starting at image pixel (x, y), at
+'scale' output pixels per image pixel, to 'out'. Output outside the image is
+black. Nodes smaller than an output pixel are drawn with their mean color.
+Rows of 'out' must be 4 byte aligned.*/
+void QuadTree::decompressRegion(const TreeIndex& treeIndex, double x, double y, double scale, unsigned char* out,
+	unsigned int width, unsigned int height, int pitch, const PixelLayout& layout) const {
+	const unsigned char black[bytesPerPixel - 1] = {};
+	const Region region = { x, y, scale, out, width, height, pitch, layout };
+
+	region.fill(0, height, 0, width, black);
+	if (!treeIndex.isEmpty() && scale > 0)
+		regionCell(treeIndex, 0, 0, 0, region);
+}
+
+/*Decompresses an indexed node to region.*/
+void QuadTree::regionCell(const TreeIndex& treeIndex, unsigned int level, unsigned int row, unsigned int col, const Region& region) const {
+	unsigned int i0, i1, j0, j1;
+	if (!region.span(treeIndex.side, level, row, col, i0, i1, j0, j1))
+		return;
+
+	const TreeIndex::Cell& cell = treeIndex.levels[level][((size_t)row << level) + col];
+
+	/*Leaves and nodes that fit in an output pixel are filled.*/
+	if (cell.leaf || (treeIndex.side >> level) * region.scale <= 1)
+		region.fill(i0, i1, j0, j1, cell.rgb);
+
+	/*Indexed children are reached through their cells.*/
+	else if (level < treeIndex.indexDepth) {
+		for (unsigned int i = 0; i < divide; i++)
+			regionCell(treeIndex, level + 1, 2 * row + i / 2, 2 * col + i % 2, region);
+	}
+
+	/*Deeper ones are parsed from the tree.*/
+	else {
+		const unsigned char* ptr = treeIndex.tree + cell.offset;
+		regionNode(treeIndex, &ptr, treeIndex.tree + treeIndex.size, level, row, col, region);
+	}
+}
+
+/*Decompresses the node at 'ptr' to region, and moves 'ptr' past its subtree.
+Throws if the subtree runs past 'end' or has an unknown node.*/
+void QuadTree::regionNode(const TreeIndex& treeIndex, const unsigned char** ptr, const unsigned char* end, unsigned int level, unsigned int row, unsigned int col, const Region& region) const {
+	unsigned int i0, i1, j0, j1;
+	const bool visible = region.span(treeIndex.side, level, row, col, i0, i1, j0, j1);
+
+	if (*ptr >= end || level > treeIndex.depth || (**ptr != treeData::noChildren && **ptr != treeData::hasChildren))
+		throw std::exception("Decompress got an invalid input.");
+
+	/*Leaves are filled.*/
+	if (**ptr == treeData::noChildren) {
+		if (*ptr + bytesPerPixel > end)
+			throw std::exception("Decompress got an invalid input.");
+		if (visible)
+			region.fill(i0, i1, j0, j1, *ptr + 1);
+		(*ptr) += bytesPerPixel;
+	}
+
+	/*Hidden subtrees are skipped, and those that fit in an output pixel are averaged.*/
+	else if (!visible || (treeIndex.side >> level) * region.scale <= 1) {
+		double color[bytesPerPixel - 1] = {};
+		unsigned char rgb[bytesPerPixel - 1];
+
+		averageSubtree(ptr, end, 1, color);
+		for (unsigned int i = 0; i < bytesPerPixel - 1; i++)
+			rgb[i] = (unsigned char)color[i];
+		if (visible)
+			region.fill(i0, i1, j0, j1, rgb);
+	}
+
+	/*Otherwise, children are decompressed.*/
+	else {
+		(*ptr)++;
+		for (unsigned int i = 0; i < divide; i++)
+			regionNode(treeIndex, ptr, end, level + 1, 2 * row + i / 2, 2 * col + i % 2, region);
 	}
+}
 
-	if (!inputFile)
-		throw std::exception("Memory allocation for file failed.");
+/*Decodes compressed data from inputFile. */
+void QuadTree::decodeCompressed(const std::vector<unsigned char>& data) {
+	/*Decodes data.*/
+	Codec::get(containerFormat).decode(data.data(), data.size(), &inputFile, &width, &height);
 
 	/*Sets real width.*/
 	width *= bytesPerPixel;
@@ -285,15 +1143,17 @@ void QuadTree::decodeCompressed(const std::string& fileName) {
 	index = 1;
 	for (; inputFile[index] == treeData::filling; index++) {};
 	inputFile += index;
-
-	/*Allocates space for decompressed file.*/
-	outputFile = (unsigned char*)malloc(realsize * sizeof(unsigned char));
 }
 
 /*Decompresses data from vector. */
 void QuadTree::decompress(unsigned char** ptr) {
+	stats.nodes++;
+
 	/*If it found a leaf...*/
 	if (**ptr == treeData::noChildren) {
+		stats.leaves++;
+		stats.maxDepth = std::max(stats.maxDepth, (unsigned int)absPosit.size());
+
 		/*'Removes' flag from vector.*/
 		(*ptr)++;
 
@@ -321,30 +1181,39 @@ void QuadTree::decompress(unsigned char** ptr) {
 		throw std::exception("Decompress got an invalid input.");
 }
 
-/*Encodes raw data to outputFile.*/
-void QuadTree::encodeRaw(const std::string& fileName) {
+/*Hands raw data to sink. If decompressed data was not written
+straight into the sink's buffer, it is passed as rows.*/
+void QuadTree::encodeRaw(PixelSink& sink, bool ownsOutput) {
 	/*Sets size equal to width-height (in pixels) of the data.*/
 	unsigned int size = static_cast<unsigned int> (sqrt(realsize / bytesPerPixel));
 
-	/*Encodes data to outputFile and checks for errors.*/
-	int error = lodepng_encode32_file(fileName.c_str(), outputFile, size, size);
-	if (error) {
-		std::string errStr = "Failed to encode raw file. Lodepng error: " + (std::string) lodepng_error_text(error);
-		throw std::exception(errStr.c_str());
+	try {
+		if (ownsOutput)
+			sink.write(outputFile, 0, size);
+		sink.close();
 	}
+	catch (...) {
+		freeDecompressed(ownsOutput);
+		throw;
+	}
+
+	freeDecompressed(ownsOutput);
+}
 
+/*Frees decompression memory. outputFile is only freed if it's not owned by a sink.*/
+void QuadTree::freeDecompressed(bool ownsOutput) {
 	/*Returns to original position.*/
 	inputFile -= index;
+	index = 0;
 
 	/*Frees memory.*/
 	if (inputFile) {
 		free(inputFile);
 		inputFile = nullptr;
 	}
-	if (outputFile) {
+	if (outputFile && ownsOutput)
 		free(outputFile);
-		outputFile = nullptr;
-	}
+	outputFile = nullptr;
 }
 
 /*Fills a given portion of the decompressed vector.*/
@@ -389,6 +1258,10 @@ void QuadTree::fillDecompressedVector(const unsigned char* rgb, const std::vecto
 
 /*Returns a usable string to use as filename, according to the specified format.*/
 const std::string QuadTree::parse(const std::string& filename, const std::string& Format) const {
+	/*Standard streams have no format.*/
+	if (filename == stdStream)
+		return filename;
+
 	/*If filename has no specified format, it returns the same string plus its format.*/
 	if (filename.find('.') == std::string::npos)
 		return filename + '.' + Format;
@@ -401,6 +1274,32 @@ const std::string QuadTree::parse(const std::string& filename, const std::string
 	throw std::exception(errStr.c_str());
 }
 
+/*Returns a usable input image filename. Any format with a registered codec
+is accepted. If filename has no format, it's kept as it is if such a file
+exists, so its format is detected from its data. Otherwise, imageFormat is used.*/
+const std::string QuadTree::parseImage(const std::string& filename) const {
+	const std::string ext = Codec::extension(filename);
+
+	/*Stdin format is detected from data.*/
+	if (filename == stdStream)
+		return filename;
+
+	if (!ext.length())
+		return std::ifstream(filename, std::ios::binary).good() ? filename : filename + '.' + imageFormat;
+
+	if (Codec::exists(ext))
+		return filename;
+
+	const std::string errStr = "Wrong image format. No codec available for ." + ext + '.';
+	throw std::exception(errStr.c_str());
+}
+
+/*Getters.*/
+const std::string& QuadTree::getFormat(void) const { return format; }
+const std::string& QuadTree::getImageFormat(void) const { return imageFormat; }
+SplitCriterion QuadTree::getCriterion(void) const { return criterion; }
+const CodecStats& QuadTree::getStats(void) const { return stats; }
+
 /*Frees memory if it hasn't already been freed.*/
 QuadTree::~QuadTree() {
 	if (inputFile)
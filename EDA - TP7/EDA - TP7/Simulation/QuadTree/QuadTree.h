@@ -1,6 +1,38 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <memory>
+#include "Codec/Codec.h"
+#include "CodecStats/CodecStats.h"
+#include "StatsPyramid/StatsPyramid.h"
+
+class PixelSink;
+struct PixelLayout;
+class TreeIndex;
+struct Estimate;
+struct Quality;
+
+/*What compression aims at: a fixed threshold, an output size cap in bytes,
+or a minimum PSNR in dB.*/
+/********************************/
+enum class TargetMode : int {
+	THRESHOLD = 0,
+	SIZE,
+	PSNR
+};
+/********************************/
+
+/*Compression job. Holds a file's data between compression stages.*/
+struct CompressionJob {
+	std::string input, output, format, error;
+	std::vector<unsigned char> data, tree;
+	std::unique_ptr<unsigned char, freeDeleter> pixels;
+	unsigned int index, width, height;
+	size_t inputSize;
+	double threshold;
+	SplitCriterion criterion;
+	CodecStats stats;
+};
 
 class QuadTree {
 public:
@@ -9,19 +41,85 @@ public:
 
 	~QuadTree();
 	void compressAndSave(const std::string&, const std::string&, const double);
+	void compressAndSave(const std::string&, const std::string&, const std::vector<double>&);
+	double compressAndSave(const std::string&, const std::string&, const TargetMode, const double);
 
 	void decompressAndSave(const std::string&, const std::string&);
+	void decompressAndSave(const std::string&, PixelSink&);
+
+	/*In-memory versions. Encoded data is read and written by caller.*/
+	void compressBuffer(const std::vector<unsigned char>&, const std::string&, std::vector<unsigned char>&, const double);
+	void decompressBuffer(const std::vector<unsigned char>&, PixelSink&);
+
+	/*Round trip check. Decompresses a compressed image and compares it with the
+	encoded image it was compressed from. Its SSIM is added to the last call's stats.*/
+	const Quality verify(const std::vector<unsigned char>&, const std::string&, const std::vector<unsigned char>&);
+
+	/*Low resolution decompression, for thumbnails. Subtrees smaller than an
+	output pixel are averaged instead of filled.*/
+	void decompressShallow(const std::vector<unsigned char>&, unsigned int, PixelSink&);
+
+	/*Region decompression, for viewers. Tree is indexed once, and then any region
+	is decompressed at the level of detail of the given scale (output pixels per
+	image pixel), to a 32 bit buffer with the given pitch and channel layout, such
+	as a locked bitmap.*/
+	void indexCompressed(const std::vector<unsigned char>&, TreeIndex&);
+	void decompressRegion(const TreeIndex&, double, double, double, unsigned char*, unsigned int, unsigned int, int, const PixelLayout&) const;
+
+	/*Compression stages. Each one can run on a different QuadTree, so batches can be pipelined.*/
+	void decodeStage(CompressionJob&);
+	void buildStage(CompressionJob&);
+	void encodeStage(CompressionJob&);
+
+	/*Decodes an image and builds its node statistics, so it can be
+	compressed at any threshold without scanning its pixels again.
+	Statistics can be capped to their top levels, as in StatsPyramid::build.*/
+	void buildStats(const std::vector<unsigned char>&, const std::string&, StatsPyramid&, unsigned int = UINT_MAX);
+	void compressStats(const StatsPyramid&, std::vector<unsigned char>&, const double);
+
+	/*Compresses an image at several thresholds, decoding it and building its statistics once.*/
+	void compressThresholds(const std::vector<unsigned char>&, const std::string&, const std::vector<double>&, std::vector<std::vector<unsigned char>>&);
+	const std::string tierName(const std::string&, const double) const;
+
+	/*Predicts node count, compressed size and PSNR at each threshold from a sample of the image.*/
+	const std::vector<Estimate> estimate(const std::vector<unsigned char>&, const std::string&, const std::vector<double>&);
+
+	/*Compresses an image aiming at a size or quality target, searching the threshold
+	over its statistics. Returns the threshold used.*/
+	double compressTarget(const std::vector<unsigned char>&, const std::string&, std::vector<unsigned char>&, const TargetMode, const double);
 
 	void setFormat(const std::string&);
+	void setImageFormat(const std::string&);
+
+	/*Split criterion of later compressions and statistics. Variance splits are
+	decided from node statistics, so pixels are read once.*/
+	void setCriterion(SplitCriterion);
+
+	const std::string& getFormat(void) const;
+	const std::string& getImageFormat(void) const;
+	SplitCriterion getCriterion(void) const;
+
+	/*Stats of the last compression or decompression. Stages keep them in their job instead.*/
+	const CodecStats& getStats(void) const;
+
+	/*Data input verifier.*/
+	const std::string parse(const std::string&, const std::string&) const;
+	const std::string parseImage(const std::string&) const;
 
 private:
+	/*Measures private kernels.*/
+	friend class Benchmark;
 
 	/*Compression*/
 	/***********************************************************************************************************/
-	void decodeRaw(const std::string&);
+	void decodeRaw(const std::vector<unsigned char>&, const std::string&);
 	void checkData(void) const;
-	void compress(const unsigned char*, unsigned int, unsigned int);
-	void encodeCompressed(const std::string&);
+	void compress(const unsigned char*, unsigned int, unsigned int, unsigned int = 0);
+	void compress(const StatsPyramid&, const double, unsigned int, unsigned int, unsigned int);
+	void compressVariance(std::unique_ptr<unsigned char, freeDeleter>, const double);
+	double searchSize(const StatsPyramid&, const double, std::vector<unsigned char>&, CodecStats&);
+	double searchPSNR(const StatsPyramid&, const double, std::vector<unsigned char>&, CodecStats&);
+	void encodeCompressed(std::vector<unsigned char>&);
 
 	const unsigned char* getNewPosition(const unsigned char*, unsigned int, unsigned int, unsigned int) const;
 	bool lessThanThreshold(const unsigned char*, unsigned int, unsigned int);
@@ -29,15 +127,23 @@ private:
 
 	/*Decompression*/
 	/***********************************************************************/
-	void encodeRaw(const std::string&);
+	void encodeRaw(PixelSink&, bool);
+	void freeDecompressed(bool);
 	void decompress(unsigned char**);
-	void decodeCompressed(const std::string&);
+	void decodeCompressed(const std::vector<unsigned char>&);
 
 	void fillDecompressedVector(const unsigned char*, const std::vector<unsigned int>&);
-	/***********************************************************************/
 
-	/*Data input verifier.*/
-	const std::string parse(const std::string&, const std::string&) const;
+	void decompressShallow(const unsigned char**, const unsigned char*, unsigned int, unsigned int, unsigned int, unsigned int);
+	void averageSubtree(const unsigned char**, const unsigned char*, double, double*) const;
+
+	/*Output region of decompressRegion.*/
+	struct Region;
+
+	void indexNode(TreeIndex&, const unsigned char**, const unsigned char*, unsigned int, unsigned int, unsigned int, double*) const;
+	void regionCell(const TreeIndex&, unsigned int, unsigned int, unsigned int, const Region&) const;
+	void regionNode(const TreeIndex&, const unsigned char**, const unsigned char*, unsigned int, unsigned int, unsigned int, const Region&) const;
+	/***********************************************************************/
 
 	/*Prevents from using copy constructor.*/
 	QuadTree(const QuadTree&);
@@ -56,6 +162,10 @@ private:
 
 	/*User input.*/
 	double threshold;
-	std::string format;
+	std::string format, imageFormat;
+	SplitCriterion criterion;
+
+	/*Stats of last call.*/
+	CodecStats stats;
 	/***********************************************/
 };
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "StatsPyramid.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+/*Constants to use throughout pyramid. They match QuadTree's.*/
+/********************************************/
+namespace {
+	const unsigned int channels = 3;
+	const unsigned int bytesPerPixel = 4;
+	const unsigned char alpha = 255;
+	const unsigned int maxDif = 3 * 255;
+
+	/*Largest standard deviation of a channel, half its range. Variance
+	thresholds are fractions of it.*/
+	const double maxDeviation = 255 / 2.0;
+}
+/********************************************/
+
+StatsPyramid::StatsPyramid() : side(0), depth(0), criterion(SplitCriterion::RANGE) {}
+
+/*Builds statistics of the given square RGBA image, whose side is a power of 2.
+Pyramid takes ownership of the pixels. At most 'maxLevels' levels of nodes
+are kept, from the root down. Lowest kept level is built from its blocks of
+pixels, and each level above it from the one below it.*/
+void StatsPyramid::build(std::unique_ptr<unsigned char, freeDeleter> image, unsigned int imageSide, unsigned int maxLevels) {
+	pixels = std::move(image);
+	side = imageSide;
+	for (depth = 0; (1u << depth) < side; depth++) {};
+
+	const unsigned int kept = std::min(depth, maxLevels);
+	levels.assign(kept, std::vector<Node>());
+	for (unsigned int level = 0; level < kept; level++)
+		levels[level].resize((size_t)1 << (2 * level));
+
+	if (!kept)
+		return;
+
+	/*Lowest level, from blocks of 'block' pixels per side. They're 2x2 unless levels are capped.*/
+	const unsigned int lowSide = 1 << (kept - 1);
+	const unsigned int block = side / lowSide;
+	for (unsigned int row = 0; row < lowSide; row++) {
+		for (unsigned int col = 0; col < lowSide; col++) {
+			Node& node = levels[kept - 1][(size_t)row * lowSide + col];
+			const unsigned char* first = pixels.get() + ((size_t)row * side + col) * block * bytesPerPixel;
+
+			for (unsigned int c = 0; c < channels; c++) {
+				node.sum[c] = node.sumSq[c] = 0;
+				node.min[c] = node.max[c] = first[c];
+			}
+			for (unsigned int i = 0; i < block; i++) {
+				const unsigned char* pixel = first + (size_t)i * side * bytesPerPixel;
+				for (unsigned int j = 0; j < block; j++, pixel += bytesPerPixel) {
+					for (unsigned int c = 0; c < channels; c++) {
+						node.sum[c] += pixel[c];
+						node.sumSq[c] += pixel[c] * pixel[c];
+						node.min[c] = std::min(node.min[c], pixel[c]);
+						node.max[c] = std::max(node.max[c], pixel[c]);
+					}
+				}
+			}
+		}
+	}
+
+	/*Upper levels, from their four children.*/
+	for (unsigned int level = kept - 1; level-- > 0;) {
+		const unsigned int levelSide = 1 << level;
+		const std::vector<Node>& below = levels[level + 1];
+
+		for (unsigned int row = 0; row < levelSide; row++) {
+			for (unsigned int col = 0; col < levelSide; col++) {
+				Node& node = levels[level][(size_t)row * levelSide + col];
+				const Node* children[] = { &below[(size_t)2 * row * 2 * levelSide + 2 * col], &below[(size_t)2 * row * 2 * levelSide + 2 * col + 1],
+					&below[(size_t)(2 * row + 1) * 2 * levelSide + 2 * col], &below[(size_t)(2 * row + 1) * 2 * levelSide + 2 * col + 1] };
+
+				node = *children[0];
+				for (unsigned int i = 1; i < 4; i++) {
+					for (unsigned int c = 0; c < channels; c++) {
+						node.sum[c] += children[i]->sum[c];
+						node.sumSq[c] += children[i]->sumSq[c];
+						node.min[c] = std::min(node.min[c], children[i]->min[c]);
+						node.max[c] = std::max(node.max[c], children[i]->max[c]);
+					}
+				}
+			}
+		}
+	}
+}
+
+/*Checks if node is a leaf at the given threshold, with pyramid's criterion.
+Range criterion is the same as QuadTree::lessThanThreshold's. Single pixels
+are always leaves.*/
+bool StatsPyramid::isLeaf(unsigned int level, unsigned int row, unsigned int col, const double threshold) const {
+	if (level >= depth)
+		return true;
+
+	const Node& node = getNode(level, row, col);
+	unsigned int value = 0;
+
+	if (criterion == SplitCriterion::VARIANCE) {
+		double sum[channels], sumSq[channels];
+		for (unsigned int c = 0; c < channels; c++) {
+			sum[c] = (double)node.sum[c];
+			sumSq[c] = (double)node.sumSq[c];
+		}
+		return isSmooth((double)((uint64_t)1 << (2 * (depth - level))), sum, sumSq, threshold);
+	}
+
+	for (unsigned int c = 0; c < channels; c++)
+		value += node.max[c] - node.min[c];
+
+	return value <= threshold * maxDif;
+}
+
+/*Checks if a node's channel variances, averaged, are at most the square of
+'threshold' times the largest standard deviation. That is, if filling it with
+its mean gives an RMS error of at most that deviation.*/
+bool StatsPyramid::isSmooth(double count, const double* sum, const double* sumSq, const double threshold) {
+	const double limit = threshold * maxDeviation;
+	double variance = 0;
+
+	for (unsigned int c = 0; c < channels; c++) {
+		const double mean = sum[c] / count;
+		variance += sumSq[c] / count - mean * mean;
+	}
+	return variance <= channels * limit * limit;
+}
+
+/*Sets criterion of later split decisions.*/
+void StatsPyramid::setCriterion(SplitCriterion value) { criterion = value; }
+SplitCriterion StatsPyramid::getCriterion(void) const { return criterion; }
+
+/*Saves node's RGB color to 'rgb'. It's the mean for blocks
+and the pixel itself for single pixels.*/
+void StatsPyramid::getColor(unsigned int level, unsigned int row, unsigned int col, unsigned char* rgb) const {
+	if (level >= depth) {
+		const unsigned char* pixel = pixels.get() + ((size_t)row * side + col) * bytesPerPixel;
+		std::copy(pixel, pixel + channels, rgb);
+		return;
+	}
+
+	const Node& node = getNode(level, row, col);
+	const uint64_t count = (uint64_t)1 << (2 * (depth - level));
+
+	for (unsigned int c = 0; c < channels; c++)
+		rgb[c] = (unsigned char)(node.sum[c] / count);
+}
+
+/*Returns the squared error of the image decompressed at the given threshold
+against the original one, added over every channel of every pixel. Leaves are
+filled with their truncated mean, as in compressed files, so the error is exact.*/
+uint64_t StatsPyramid::squaredError(const double threshold) const {
+	return side ? nodeError(0, 0, 0, threshold) : 0;
+}
+
+/*Returns PSNR of the image decompressed at the given threshold, in dB.
+It's infinite if the image is decompressed without loss.*/
+double StatsPyramid::getPSNR(const double threshold) const {
+	const uint64_t error = squaredError(threshold);
+	if (!error)
+		return std::numeric_limits<double>::infinity();
+
+	const double mse = (double)error / ((double)side * side * channels);
+	return 10 * log10(255.0 * 255.0 / mse);
+}
+
+/*Recursively adds the squared error of a node's leaves.*/
+uint64_t StatsPyramid::nodeError(unsigned int level, unsigned int row, unsigned int col, const double threshold) const {
+	if (level >= depth || isLeaf(level, row, col, threshold))
+		return leafError(level, row, col);
+
+	uint64_t result = 0;
+	for (unsigned int i = 0; i < 4; i++)
+		result += nodeError(level + 1, 2 * row + i / 2, 2 * col + i % 2, threshold);
+	return result;
+}
+
+/*Returns node count of the tree compressed at the given threshold, as
+QuadTree's stats would give it. Every inner node has four children, so
+the tree has (3 * nodes + 1) / 4 leaves.*/
+uint64_t StatsPyramid::countNodes(const double threshold) const {
+	return side ? nodeCount(0, 0, 0, threshold) : 0;
+}
+
+/*Recursively counts a node and the nodes below it.*/
+uint64_t StatsPyramid::nodeCount(unsigned int level, unsigned int row, unsigned int col, const double threshold) const {
+	if (level >= depth || isLeaf(level, row, col, threshold))
+		return 1;
+
+	uint64_t result = 1;
+	for (unsigned int i = 0; i < 4; i++)
+		result += nodeCount(level + 1, 2 * row + i / 2, 2 * col + i % 2, threshold);
+	return result;
+}
+
+/*Returns the squared error of filling a node with its mean. Single pixels have none.
+For a node filled with 'mean', it's sumSq - 2 * mean * sum + count * mean^2.*/
+uint64_t StatsPyramid::leafError(unsigned int level, unsigned int row, unsigned int col) const {
+	if (level >= depth)
+		return 0;
+
+	const Node& node = getNode(level, row, col);
+	const int64_t count = (int64_t)1 << (2 * (depth - level));
+	int64_t result = 0;
+
+	for (unsigned int c = 0; c < channels; c++) {
+		const int64_t mean = node.sum[c] / count;
+		result += (int64_t)node.sumSq[c] - 2 * mean * (int64_t)node.sum[c] + count * mean * mean;
+	}
+	return (uint64_t)result;
+}
+
+/*Renders the image as it would be decompressed at the given threshold to
+'out', a square 32 bit buffer with the given pitch and channel layout, whose
+side is a power of 2 up to the image's. Nodes smaller than an output pixel
+are drawn with their mean. Rows of 'out' must be 4 byte aligned.*/
+void StatsPyramid::render(const double threshold, unsigned char* out, unsigned int outSide, int pitch, const PixelLayout& layout) const {
+	if (side)
+		renderNode(0, 0, 0, threshold, out, std::min(outSide, side), pitch, layout);
+}
+
+/*Recursively renders a node to output.*/
+void StatsPyramid::renderNode(unsigned int level, unsigned int row, unsigned int col, const double threshold,
+	unsigned char* out, unsigned int outSide, int pitch, const PixelLayout& layout) const {
+	const unsigned int size = outSide >> level;
+
+	/*Fills node's square with its color.*/
+	if (size <= 1 || isLeaf(level, row, col, threshold)) {
+		unsigned char rgb[channels], pixel[bytesPerPixel];
+		getColor(level, row, col, rgb);
+
+		pixel[layout.red] = rgb[0];
+		pixel[layout.green] = rgb[1];
+		pixel[layout.blue] = rgb[2];
+		pixel[layout.alpha] = alpha;
+
+		uint32_t value;
+		memcpy(&value, pixel, bytesPerPixel);
+		for (unsigned int i = row * size; i < (row + 1) * size; i++) {
+			uint32_t* first = reinterpret_cast<uint32_t*>(out + (ptrdiff_t)i * pitch) + col * size;
+			std::fill(first, first + size, value);
+		}
+	}
+
+	/*Otherwise, renders its children.*/
+	else {
+		for (unsigned int i = 0; i < 4; i++)
+			renderNode(level + 1, 2 * row + i / 2, 2 * col + i % 2, threshold, out, outSide, pitch, layout);
+	}
+}
+
+/*Returns a node above single pixels. Capped pyramids don't have the lowest ones.*/
+const StatsPyramid::Node& StatsPyramid::getNode(unsigned int level, unsigned int row, unsigned int col) const {
+	if (level >= levels.size())
+		throw std::exception("Node is below the lowest level of statistics.");
+	return levels[level][((size_t)row << level) + col];
+}
+
+/*Getters.*/
+const unsigned char* StatsPyramid::getPixels(void) const { return pixels.get(); }
+unsigned int StatsPyramid::getSide(void) const { return side; }
+unsigned int StatsPyramid::getDepth(void) const { return depth; }
+bool StatsPyramid::isEmpty(void) const { return !side; }
+bool StatsPyramid::isComplete(void) const { return levels.size() == depth; }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <climits>
+#include "../Codec/Codec.h"
+#include "../PixelSink/PixelSink.h"
+
+/*How split decisions are made. RANGE compares the sum of a node's channel
+ranges, as QuadTree::lessThanThreshold does. VARIANCE compares the mean of its
+channel variances, which is the MSE of filling it with its mean, so a few
+outlier pixels don't split an otherwise smooth block.*/
+/********************************/
+enum class SplitCriterion : int {
+	RANGE = 0,
+	VARIANCE
+};
+/********************************/
+
+/*Statistics of every node in a square image's quadtree, from the root down to
+2x2 blocks. Single pixels are read from the image itself, which the pyramid
+keeps. It is built once, in a single pass over the pixels, and then split
+decisions at any threshold, with either criterion, are made in constant time
+per node without scanning pixels again. Levels can be capped, so previews of
+large images only keep the top of the tree. Capped pyramids can render, but
+can't decide nodes below their lowest level.*/
+class StatsPyramid {
+public:
+	/*Per channel statistics of a node. Sums of squares give the error of
+	filling it with its mean.*/
+	struct Node {
+		uint64_t sum[3], sumSq[3];
+		unsigned char min[3], max[3];
+	};
+
+	StatsPyramid();
+
+	void build(std::unique_ptr<unsigned char, freeDeleter>, unsigned int, unsigned int = UINT_MAX);
+
+	/*Nodes are given by level (0 is root, getDepth() is single pixels), row and column.*/
+	bool isLeaf(unsigned int, unsigned int, unsigned int, const double) const;
+	void getColor(unsigned int, unsigned int, unsigned int, unsigned char*) const;
+	uint64_t leafError(unsigned int, unsigned int, unsigned int) const;
+
+	void setCriterion(SplitCriterion);
+	SplitCriterion getCriterion(void) const;
+
+	/*Variance criterion, from a node's pixel count and its channel sums and sums of squares.*/
+	static bool isSmooth(double, const double*, const double*, const double);
+
+	void render(const double, unsigned char*, unsigned int, int, const PixelLayout&) const;
+
+	/*Error of the image decompressed at the given threshold, added over every
+	channel of every pixel, and the PSNR it gives, in dB.*/
+	uint64_t squaredError(const double) const;
+	double getPSNR(const double) const;
+
+	/*Nodes of the tree compressed at the given threshold, leaves included.*/
+	uint64_t countNodes(const double) const;
+
+	const unsigned char* getPixels(void) const;
+	unsigned int getSide(void) const;
+	unsigned int getDepth(void) const;
+	bool isEmpty(void) const;
+
+	/*Whether every level down to single pixels was kept.*/
+	bool isComplete(void) const;
+
+private:
+	const Node& getNode(unsigned int, unsigned int, unsigned int) const;
+	uint64_t nodeError(unsigned int, unsigned int, unsigned int, const double) const;
+	uint64_t nodeCount(unsigned int, unsigned int, unsigned int, const double) const;
+	void renderNode(unsigned int, unsigned int, unsigned int, const double, unsigned char*, unsigned int, int, const PixelLayout&) const;
+
+	/*Prevents from using copy constructor.*/
+	StatsPyramid(const StatsPyramid&);
+
+	/*Data members.*/
+	/***********************************************/
+	std::vector<std::vector<Node>> levels;
+	std::unique_ptr<unsigned char, freeDeleter> pixels;
+	unsigned int side, depth;
+	SplitCriterion criterion;
+	/***********************************************/
+};
@@ -0,0 +1,9 @@
+#include "TreeIndex.h"
+
+TreeIndex::TreeIndex() : tree(nullptr), size(0), side(0), depth(0), indexDepth(0) {}
+
+/*Getters.*/
+unsigned int TreeIndex::getSide(void) const { return side; }
+unsigned int TreeIndex::getDepth(void) const { return depth; }
+unsigned int TreeIndex::getIndexDepth(void) const { return indexDepth; }
+bool TreeIndex::isEmpty(void) const { return !side; }
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "../Codec/Codec.h"
+
+/*Index of a compressed image's tree, so any region of it can be decompressed
+at any level of detail without walking the whole tree. Every node down to
+getIndexDepth() gets a cell with its offset in the tree and its mean color.
+Leaves above that level fill every cell they cover. Deeper nodes are parsed
+from their indexed ancestor. Built and read by QuadTree.*/
+class TreeIndex {
+public:
+	/*Indexed node.*/
+	struct Cell {
+		uint64_t offset;
+		unsigned char rgb[3];
+		bool leaf;
+	};
+
+	TreeIndex();
+
+	unsigned int getSide(void) const;
+	unsigned int getDepth(void) const;
+	unsigned int getIndexDepth(void) const;
+	bool isEmpty(void) const;
+
+private:
+	friend class QuadTree;
+
+	/*Prevents from using copy constructor.*/
+	TreeIndex(const TreeIndex&);
+
+	/*Data members.*/
+	/***********************************************/
+	std::unique_ptr<unsigned char, freeDeleter> data;
+	const unsigned char* tree;
+	uint64_t size;
+	std::vector<std::vector<Cell>> levels;
+	unsigned int side, depth, indexDepth;
+	/***********************************************/
+};
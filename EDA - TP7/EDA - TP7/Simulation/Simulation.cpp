@@ -1,14 +1,42 @@
 #include "Simulation.h"
+#include "QuadTree/Codec/Codec.h"
+#include "QuadTree/PixelSink/PixelSink.h"
+#include "QuadTree/Metrics/Metrics.h"
+#include "Pipeline/Pipeline.h"
+#include "Trace/Trace.h"
 #include <iostream>
 #include <functional>
+#include <chrono>
 
 using namespace std::placeholders;
 
+/*Batch I/O settings.*/
+/********************************************/
+namespace {
+	/*Amount of inputs read ahead of the one being processed.*/
+	const unsigned int prefetch = 4;
+	const unsigned int ioThreads = 2;
+
+	/*Pipeline settings. Stage costs are initial guesses, refined after every run.*/
+	const unsigned int queueSize = 8;
+	const unsigned int defaultThreads = 4;
+	const std::vector<double> initialCosts = { 1, 2, 1 };
+
+	/*File traced batches are written to.*/
+	const char* traceFile = "batch-trace.json";
+}
+/********************************************/
+
 //Simulation constructor.
-Simulation::Simulation(void) : running(true)
+Simulation::Simulation(void) : running(true), stageCosts(initialCosts)
 {
 	gui = new GUI;
 	qt = new QuadTree;
+	io = new AsyncIO(ioThreads);
+
+	/*Serial batches run on first worker, so 'qt' is only used by the GUI thread.*/
+	workers.emplace_back(new QuadTree);
+	gui->setProgress(&progress);
 }
 
 //Polls GUI and dispatches according to button code.
@@ -16,17 +44,77 @@ void Simulation::dispatch(const Events& code) {
 	switch (code) {
 		/*User asked to exit.*/
 	case Events::END:
+		progress.cancel();
 		running = false;
 		break;
 
 		/*User asked to compress.*/
 	case Events::COMPRESS:
-		perform(std::bind(&QuadTree::compressAndSave, qt, _1, _2, gui->getThreshold()), Events::COMPRESS);
+		if (progress.isRunning())
+			break;
+		{
+			const std::vector<fileNames> jobs = collect(
+				[this](const std::string& file, const std::string& base) {return fileNames(qt->parseImage(file), qt->parse(base, qt->getFormat())); },
+				Events::COMPRESS);
+			const double threshold = gui->getThreshold();
+			const TargetMode mode = gui->getTargetMode();
+			const double target = gui->getTarget();
+			const bool verifying = gui->isVerifying();
+			const SplitCriterion criterion = gui->getCriterion();
+
+			/*Size and PSNR targets search each file's threshold, which stages can't do.*/
+			if (mode != TargetMode::THRESHOLD) {
+				launch(jobs, [this, jobs, mode, target, verifying, criterion]() {
+					workers.front()->setCriterion(criterion);
+					perform(jobs, [this, mode, target, verifying](const std::string& input, const byteVec& data, byteVec& result) {
+						const double used = workers.front()->compressTarget(data, Codec::extension(input), result, mode, target);
+						std::cout << input << ": threshold " << used << std::endl;
+						if (verifying)
+							workers.front()->verify(data, Codec::extension(input), result);
+						});
+					});
+				break;
+			}
+
+			/*Verifying needs each file's encoded image after compression, which stages drop.*/
+			if (gui->isPipelined() && !verifying) {
+				launch(jobs, [this, jobs, threshold, criterion]() {performPipelined(jobs, threshold, criterion); });
+				break;
+			}
+			if (verifying) {
+				launch(jobs, [this, jobs, threshold, criterion]() {
+					workers.front()->setCriterion(criterion);
+					perform(jobs, [this, threshold](const std::string& input, const byteVec& data, byteVec& result) {
+						workers.front()->compressBuffer(data, Codec::extension(input), result, threshold);
+						workers.front()->verify(data, Codec::extension(input), result);
+						});
+					});
+				break;
+			}
+			launch(jobs, [this, jobs, threshold, criterion]() {
+				workers.front()->setCriterion(criterion);
+				perform(jobs, std::bind(&QuadTree::compressBuffer, workers.front().get(), _2, std::bind(&Codec::extension, _1), _3, threshold));
+				});
+		}
 		break;
 
 		/*User asked to decompress.*/
 	case Events::DECOMPRESS:
-		perform(std::bind(&QuadTree::decompressAndSave, qt, _1, _2), Events::DECOMPRESS);
+		if (progress.isRunning())
+			break;
+		{
+			const std::vector<fileNames> jobs = collect(
+				[this](const std::string& file, const std::string& base) {return fileNames(qt->parse(file, qt->getFormat()), qt->parse(base, qt->getImageFormat())); },
+				Events::DECOMPRESS);
+			const std::string imageFormat = qt->getImageFormat();
+
+			launch(jobs, [this, jobs, imageFormat]() {
+				perform(jobs, [this, &imageFormat](const std::string& input, const byteVec& data, byteVec& result) {
+					CodecSink sink(result, imageFormat);
+					workers.front()->decompressBuffer(data, sink);
+					});
+				});
+		}
 		break;
 
 		/*User changed target file format.*/
@@ -41,41 +129,224 @@ void Simulation::dispatch(const Events& code) {
 /*Generates event from GUI.*/
 const Events Simulation::eventGenerator() { return gui->checkStatus(); }
 
-/*Applies a function that takes two strings to
-every file in gui->getFiles() marked with 'ev'.*/
+/*Gets real input and output names of every listed file marked with 'ev' in the GUI.
+'names' takes file name and file name without extension.*/
+template <class N>
+const std::vector<fileNames> Simulation::collect(const N& names, const Events& ev) {
+	std::vector<fileNames> jobs;
+	int pos;
+
+	for (const auto& file : gui->getFiles(ev)) {
+		try {
+			pos = file.find_last_of(".");
+			jobs.push_back(names(file, file.substr(0, pos)));
+		}
+		catch (std::exception& e) {
+			std::cout << file << ": " << e.what() << std::endl;
+		}
+	}
+	return jobs;
+}
+
+/*Runs 'work' on the batch thread, so GUI keeps drawing and can cancel it.
+Previous batch has already finished, so joining it doesn't block.
+If tracing was asked for, batch spans are written to a trace file.*/
+void Simulation::launch(const std::vector<fileNames>& jobs, const std::function<void(void)>& work) {
+	std::vector<std::string> inputs;
+	const bool tracing = gui->isTracing();
+
+	if (batch.joinable())
+		batch.join();
+
+	for (const auto& job : jobs)
+		inputs.push_back(job.first);
+	progress.start(inputs);
+	if (tracing)
+		Trace::start();
+
+	batch = std::thread([this, work, tracing]() {
+		try {
+			work();
+		}
+		catch (std::exception& e) {
+			std::cout << e.what() << std::endl;
+		}
+		progress.finish();
+
+		if (tracing) {
+			Trace::stop();
+			try {
+				Trace::write(traceFile);
+				std::cout << "Trace written to " << traceFile << std::endl;
+			}
+			catch (std::exception& e) {
+				std::cout << e.what() << std::endl;
+			}
+		}
+
+		/*Reports where batch time went.*/
+		progress.getStats().print(std::cout);
+		});
+}
+
+/*Applies a function that takes input name, input data and an output buffer to
+every job. Upcoming inputs are prefetched and finished outputs written by io
+threads, so disk and CPU work overlap. Stops starting files once cancelled.
+'apply' runs on the first worker, whose stats are added to the batch's.*/
 template <class T>
-void Simulation::perform(const T& apply, const Events& ev) {
-	try {
-		/*Gets files from GUI.*/
-		const auto& files = gui->getFiles();
-		int pos;
-
-		/*Loops through every file and applies function to
-		the ones marked with 'ev'.*/
-		for (const auto& file : files) {
-			if (file.second == ev) {
-				pos = file.first.find_last_of(".");
-				apply(file.first, file.first.substr(0, pos));
+void Simulation::perform(const std::vector<fileNames>& jobs, const T& apply) {
+	std::deque<std::future<byteVec>> reads;
+
+	/*Pending writes, with their file index and input and output sizes.*/
+	struct Write {
+		unsigned int file;
+		std::future<void> result;
+		size_t inSize, outSize;
+	};
+	std::deque<Write> writes;
+
+	/*Reports finished writes. If 'all' is false, only those that are ready.*/
+	auto collectWrites = [this, &writes, &jobs](bool all) {
+		while (writes.size() && (all || writes.front().result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+			Write& write = writes.front();
+			try {
+				write.result.get();
+				progress.setDone(write.file, write.inSize, write.outSize);
 			}
+			catch (std::exception& e) {
+				std::cout << jobs[write.file].second << ": " << e.what() << std::endl;
+				progress.setFailed(write.file, e.what());
+			}
+			writes.pop_front();
 		}
+	};
+
+	/*Starts reading first inputs.*/
+	for (unsigned int i = 0; i < jobs.size() && i < prefetch; i++)
+		reads.push_back(io->read(jobs[i].first));
+
+	/*Loops through every file, keeping 'prefetch' reads ahead.*/
+	for (unsigned int i = 0; i < jobs.size() && !progress.isCancelled(); i++) {
+		std::future<byteVec> current = std::move(reads.front());
+		reads.pop_front();
+
+		if (i + prefetch < jobs.size())
+			reads.push_back(io->read(jobs[i + prefetch].first));
+
+		progress.setRunning(i);
+		try {
+			TraceSpan span("file", "batch", jobs[i].first.c_str());
+			byteVec data, result;
+			{
+				TraceSpan wait("wait for read", "io");
+				data = current.get();
+			}
+
+			apply(jobs[i].first, data, result);
+			progress.addStats(workers.front()->getStats());
+
+			/*Writes output in background.*/
+			size_t outSize = result.size();
+			writes.push_back({ i, io->write(jobs[i].second, std::move(result)), data.size(), outSize });
+		}
+		catch (std::exception& e) {
+			std::cout << jobs[i].first << ": " << e.what() << std::endl;
+			progress.setFailed(i, e.what());
+		}
+		collectWrites(false);
 	}
-	catch (std::exception& e) {
-		std::cout << e.what() << std::endl;
+
+	/*Waits for pending writes and reports their results.*/
+	collectWrites(true);
+}
+
+/*Compresses every job through a decode -> build -> encode pipeline. Workers
+are split among stages according to their measured cost, so the slowest stage
+gets the most workers.*/
+void Simulation::performPipelined(const std::vector<fileNames>& names, const double threshold, const SplitCriterion criterion) {
+	std::vector<CompressionJob> jobs;
+
+	for (unsigned int i = 0; i < names.size(); i++) {
+		CompressionJob job;
+		job.index = i;
+		job.input = names[i].first;
+		job.output = names[i].second;
+		job.format = Codec::extension(job.input);
+		job.threshold = threshold;
+		job.criterion = criterion;
+		job.inputSize = 0;
+		jobs.push_back(std::move(job));
+	}
+
+	/*Splits threads among stages.*/
+	unsigned int threads = std::thread::hardware_concurrency();
+	const std::vector<unsigned int> count = Pipeline<CompressionJob>::balance(stageCosts, threads ? threads : defaultThreads);
+
+	Pipeline<CompressionJob> pipeline(queueSize);
+	pipeline.addStage("decode", count[0], [this](CompressionJob& job, unsigned int id) {
+		TraceSpan span("decode stage", "pipeline", job.input.c_str());
+		progress.setRunning(job.index);
+		{
+			TraceSpan read("read", "io", job.input.c_str());
+			Codec::readFile(job.input, job.data);
+		}
+		job.inputSize = job.data.size();
+		workers[id]->decodeStage(job);
+		});
+	pipeline.addStage("build", count[1], [this](CompressionJob& job, unsigned int id) {
+		TraceSpan span("build stage", "pipeline", job.input.c_str());
+		workers[id]->buildStage(job);
+		});
+	pipeline.addStage("encode", count[2], [this](CompressionJob& job, unsigned int id) {
+		TraceSpan span("encode stage", "pipeline", job.input.c_str());
+		workers[id]->encodeStage(job);
+
+		TraceSpan write("write", "io", job.output.c_str());
+		Codec::writeFile(job.output, job.data);
+		});
+
+	/*Each worker gets its own QuadTree.*/
+	while (workers.size() < pipeline.workerCount())
+		workers.emplace_back(new QuadTree);
+
+	pipeline.run(std::move(jobs), [this](CompressionJob& job) {
+		if (job.error.length()) {
+			std::cout << job.input << ": " << job.error << std::endl;
+			progress.setFailed(job.index, job.error);
+		}
+		else {
+			progress.addStats(job.stats);
+			progress.setDone(job.index, job.inputSize, job.data.size());
+		}
+		}, &progress.cancelFlag());
+
+	/*Updates stage costs with the ones measured in this run.*/
+	const std::vector<double> measured = pipeline.stageTimes();
+	for (unsigned int i = 0; i < measured.size(); i++) {
+		if (measured[i] > 0)
+			stageCosts[i] = measured[i];
 	}
 }
 
-/*Sets new QuadTree target format.*/
+/*Sets new QuadTree target formats.*/
 void Simulation::setFormat() {
 	qt->setFormat(gui->getFormat());
+	qt->setImageFormat(gui->getImageFormat());
 }
 
 /*Getter.*/
 bool Simulation::isRunning(void) { return running; }
 
-/*Simulation destructor. Deletes used resources.*/
+/*Simulation destructor. Stops running batch and deletes used resources.*/
 Simulation::~Simulation() {
+	progress.cancel();
+	if (batch.joinable())
+		batch.join();
+
 	if (gui)
 		delete gui;
 	if (qt)
 		delete qt;
+	if (io)
+		delete io;
 }
\ No newline at end of file
@@ -2,6 +2,13 @@
 
 #include "GUI/GUI.h"
 #include "QuadTree/QuadTree.h"
+#include "AsyncIO/AsyncIO.h"
+#include "Progress/Progress.h"
+#include <memory>
+#include <thread>
+
+/*Real input and output names of a batch file.*/
+using fileNames = std::pair<std::string, std::string>;
 
 class Simulation {
 public:
@@ -16,8 +23,15 @@ public:
 
 private:
 
+	template <class N>
+	const std::vector<fileNames> collect(const N&, const Events&);
+
+	void launch(const std::vector<fileNames>&, const std::function<void(void)>&);
+
 	template <class T>
-	void perform(const T&, const Events&);
+	void perform(const std::vector<fileNames>&, const T&);
+
+	void performPipelined(const std::vector<fileNames>&, const double, const SplitCriterion);
 
 	void setFormat();
 
@@ -26,6 +40,13 @@ private:
 
 	GUI* gui;
 	QuadTree* qt;
+	AsyncIO* io;
+
+	/*Batch data. Batches run on their own thread, with their own QuadTrees.*/
+	std::thread batch;
+	Progress progress;
+	std::vector<std::unique_ptr<QuadTree>> workers;
+	std::vector<double> stageCosts;
 
 	bool running;
 };
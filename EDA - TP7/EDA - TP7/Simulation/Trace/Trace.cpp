@@ -0,0 +1,152 @@
+#include "Trace.h"
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <cstring>
+
+/*Trace buffers. Each thread gets its own the first time it records a span
+while tracing. Buffers outlive their threads, so spans of finished worker
+threads are written too, and are retired when their thread exits. Retired
+buffers are dropped by the next start, as batches make new threads each time.*/
+/********************************************/
+namespace {
+	/*Spans kept per thread, and characters kept of each span's detail.*/
+	const size_t bufferSize = 16384;
+	const size_t detailSize = 64;
+
+	struct Span {
+		const char* name, * category;
+		double start, duration;
+		char detail[detailSize];
+	};
+
+	struct Buffer {
+		std::vector<Span> spans;
+		std::atomic<size_t> count;
+		std::atomic<bool> retired;
+		unsigned int thread;
+	};
+
+	/*A thread's reference to its buffer. Retires it when the thread exits.*/
+	struct Holder {
+		std::shared_ptr<Buffer> buffer;
+
+		~Holder() {
+			if (buffer)
+				buffer->retired = true;
+		}
+	};
+
+	std::mutex mtx;
+	std::vector<std::shared_ptr<Buffer>> buffers;
+	std::chrono::steady_clock::time_point origin;
+	unsigned int threads = 0;
+
+	/*Returns calling thread's buffer, creating it on first use.*/
+	Buffer& threadBuffer(void) {
+		thread_local Holder holder;
+
+		if (!holder.buffer) {
+			holder.buffer = std::make_shared<Buffer>();
+			holder.buffer->spans.resize(bufferSize);
+			holder.buffer->count = 0;
+			holder.buffer->retired = false;
+
+			std::lock_guard<std::mutex> lock(mtx);
+			holder.buffer->thread = ++threads;
+			buffers.push_back(holder.buffer);
+		}
+		return *holder.buffer;
+	}
+
+	/*Writes a string as a JSON string.*/
+	void writeString(std::ostream& out, const char* text) {
+		out << '"';
+		for (; *text; text++) {
+			if (*text == '"' || *text == '\\')
+				out << '\\' << *text;
+			else if ((unsigned char)*text >= ' ')
+				out << *text;
+		}
+		out << '"';
+	}
+}
+/********************************************/
+
+std::atomic<bool> Trace::enabled(false);
+
+/*Discards previous spans, and buffers of threads that have exited, and starts
+recording. Times are relative to this call. Must not be called while spans are
+being recorded.*/
+void Trace::start(void) {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		origin = std::chrono::steady_clock::now();
+		buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+			[](const std::shared_ptr<Buffer>& buffer) { return buffer->retired.load(); }), buffers.end());
+		for (auto& buffer : buffers)
+			buffer->count = 0;
+	}
+	enabled = true;
+}
+
+/*Stops recording. Spans already started are still saved when they end.*/
+void Trace::stop(void) { enabled = false; }
+
+/*Saves a span that started at 'begin' and ends now. Oldest spans
+are overwritten once the thread's buffer is full.*/
+void Trace::record(const char* name, const char* category, const char* detail, const std::chrono::steady_clock::time_point& begin) {
+	const auto end = std::chrono::steady_clock::now();
+	Buffer& buffer = threadBuffer();
+	const size_t count = buffer.count.load(std::memory_order_relaxed);
+	Span& span = buffer.spans[count % bufferSize];
+
+	span.name = name;
+	span.category = category;
+	span.start = std::chrono::duration<double, std::micro>(begin - origin).count();
+	span.duration = std::chrono::duration<double, std::micro>(end - begin).count();
+	span.detail[0] = '\0';
+	if (detail) {
+		strncpy(span.detail, detail, detailSize - 1);
+		span.detail[detailSize - 1] = '\0';
+	}
+
+	buffer.count.store(count + 1, std::memory_order_release);
+}
+
+/*Writes every saved span as a Chrome trace JSON file. Should be called
+once traced work is done, so no thread is still recording.*/
+void Trace::write(const std::string& fileName) {
+	std::ofstream out(fileName);
+	if (!out)
+		throw std::exception(("Failed to open file " + fileName + '.').c_str());
+
+	std::lock_guard<std::mutex> lock(mtx);
+	bool first = true;
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (const auto& buffer : buffers) {
+		const size_t count = buffer->count.load(std::memory_order_acquire);
+		const size_t oldest = count > bufferSize ? count - bufferSize : 0;
+
+		for (size_t i = oldest; i < count; i++) {
+			const Span& span = buffer->spans[i % bufferSize];
+
+			out << (first ? "" : ",") << std::endl << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread
+				<< ",\"ts\":" << std::fixed << span.start << ",\"dur\":" << span.duration << ",\"name\":";
+			writeString(out, span.name);
+			out << ",\"cat\":";
+			writeString(out, span.category);
+			if (span.detail[0]) {
+				out << ",\"args\":{\"file\":";
+				writeString(out, span.detail);
+				out << '}';
+			}
+			out << '}';
+			first = false;
+		}
+	}
+	out << std::endl << "]}" << std::endl;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <chrono>
+
+/*Span tracing for batches. While enabled, every TraceSpan that ends is saved to
+a ring buffer owned by its thread, so recording takes no lock. Each buffer keeps
+its newest spans. Traces are written as Chrome trace JSON, which Perfetto and
+chrome://tracing load. When disabled, a span costs a single flag check.*/
+class Trace {
+public:
+	static void start(void);
+	static void stop(void);
+	static void write(const std::string&);
+
+	static bool isEnabled(void) { return enabled.load(std::memory_order_acquire); }
+
+	/*Saves a finished span to the calling thread's buffer.*/
+	static void record(const char*, const char*, const char*, const std::chrono::steady_clock::time_point&);
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+/*Times the scope it lives in. Name and category must be string literals, as
+only their pointers are kept. Detail, such as a file name, is copied and
+may be truncated.*/
+class TraceSpan {
+public:
+	TraceSpan(const char* name, const char* category, const char* detail = nullptr) :
+		name(name), category(category), detail(detail), active(Trace::isEnabled()) {
+		if (active)
+			begin = std::chrono::steady_clock::now();
+	}
+
+	~TraceSpan() {
+		if (active)
+			Trace::record(name, category, detail, begin);
+	}
+
+private:
+	/*Prevents from using copy constructor.*/
+	TraceSpan(const TraceSpan&);
+
+	/*Data members.*/
+	/***********************************************/
+	const char* name, * category, * detail;
+	std::chrono::steady_clock::time_point begin;
+	bool active;
+	/***********************************************/
+};
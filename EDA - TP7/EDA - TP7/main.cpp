@@ -1,8 +1,13 @@
 #include <iostream>
 #include "Simulation/Simulation.h"
-int main() {
+#include "Simulation/Console/Console.h"
+int main(int argc, char** argv) {
 	int result = -1;
 
+	/*If arguments were given, runs from command line without GUI.*/
+	if (argc > 1)
+		return Console(argc, argv).run();
+
 	try {
 		Simulation mySim;
 